@@ -1,15 +1,26 @@
 #version 330 core
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec2 aTexCoords;
+// where this copy stands, see instancing.h; an identity matrix outside
+// instanced draws
+layout (location = 4) in mat4 aInstanceModel;
 
 out vec2 TexCoords;
 
+layout (std140) uniform Camera
+{
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    vec4 cameraPosition;
+};
+
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+// scale (xy) and offset (zw) back from quantized texture coordinates
+uniform vec4 uvTransform;
 
 void main()
 {
-    TexCoords = aTexCoords;    
-    gl_Position = projection * view * model * vec4(aPos, 1.0);
+    TexCoords = aTexCoords * uvTransform.xy + uvTransform.zw;
+    gl_Position = viewProjection * aInstanceModel * model * vec4(aPos, 1.0);
 }
\ No newline at end of file
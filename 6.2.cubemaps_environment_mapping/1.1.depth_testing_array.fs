@@ -0,0 +1,12 @@
+#version 330 core
+out vec4 FragColor;
+
+in vec2 TexCoords;
+flat in float Layer;
+
+uniform sampler2DArray materials;
+
+void main()
+{    
+    FragColor = texture(materials, vec3(TexCoords, Layer));
+}
\ No newline at end of file
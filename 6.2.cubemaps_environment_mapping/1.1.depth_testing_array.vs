@@ -0,0 +1,30 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec2 aTexCoords;
+layout (location = 3) in float aLayer;
+// where this copy stands and the layer it adds to aLayer, see instancing.h;
+// an identity matrix and 0 outside instanced draws
+layout (location = 4) in mat4 aInstanceModel;
+layout (location = 8) in float aMaterial;
+
+out vec2 TexCoords;
+flat out float Layer;
+
+layout (std140) uniform Camera
+{
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    vec4 cameraPosition;
+};
+
+uniform mat4 model;
+// scale (xy) and offset (zw) back from quantized texture coordinates
+uniform vec4 uvTransform;
+
+void main()
+{
+    TexCoords = aTexCoords * uvTransform.xy + uvTransform.zw;
+    Layer = aLayer + aMaterial;
+    gl_Position = viewProjection * aInstanceModel * model * vec4(aPos, 1.0);
+}
\ No newline at end of file
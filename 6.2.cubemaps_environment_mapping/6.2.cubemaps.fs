@@ -4,12 +4,19 @@ out vec4 FragColor;
 in vec3 Normal;
 in vec3 Position;
 
-uniform vec3 cameraPos;
+layout (std140) uniform Camera
+{
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    vec4 cameraPosition;
+};
+
 uniform samplerCube skybox;
 
 void main()
 {    
-    vec3 I = normalize(Position - cameraPos);
+    vec3 I = normalize(Position - cameraPosition.xyz);
     vec3 R = reflect(I, normalize(Normal));
     FragColor = vec4(texture(skybox, R).rgb, 1.0);
 }
\ No newline at end of file
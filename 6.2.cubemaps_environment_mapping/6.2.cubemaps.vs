@@ -1,17 +1,28 @@
 #version 330 core
 layout (location = 0) in vec3 aPos;
-layout (location = 1) in vec3 aNormal;
+// the procedural meshes keep the normal at 2, after the texture coordinates
+layout (location = 2) in vec3 aNormal;
+// where this copy stands, see instancing.h; an identity matrix outside
+// instanced draws
+layout (location = 4) in mat4 aInstanceModel;
 
 out vec3 Normal;
 out vec3 Position;
 
+layout (std140) uniform Camera
+{
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    vec4 cameraPosition;
+};
+
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
 
 void main()
 {
-    Normal = mat3(transpose(inverse(model))) * aNormal;
-    Position = vec3(model * vec4(aPos, 1.0));
-    gl_Position = projection * view * model * vec4(aPos, 1.0);
+    mat4 world = aInstanceModel * model;
+    Normal = mat3(transpose(inverse(world))) * aNormal;
+    Position = vec3(world * vec4(aPos, 1.0));
+    gl_Position = viewProjection * vec4(Position, 1.0);
 }
\ No newline at end of file
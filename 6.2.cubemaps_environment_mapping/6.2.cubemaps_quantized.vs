@@ -0,0 +1,37 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;
+// octahedral, see vertex_format.h
+layout (location = 2) in vec2 aNormal;
+// where this copy stands, see instancing.h; an identity matrix outside
+// instanced draws
+layout (location = 4) in mat4 aInstanceModel;
+
+out vec3 Normal;
+out vec3 Position;
+
+layout (std140) uniform Camera
+{
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    vec4 cameraPosition;
+};
+
+// includes the mesh's positionTransform
+uniform mat4 model;
+
+vec3 octahedralDecode(vec2 e)
+{
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    if (n.z < 0.0)
+        n.xy = (1.0 - abs(e.yx)) * vec2(e.x >= 0.0 ? 1.0 : -1.0, e.y >= 0.0 ? 1.0 : -1.0);
+    return normalize(n);
+}
+
+void main()
+{
+    mat4 world = aInstanceModel * model;
+    Normal = mat3(transpose(inverse(world))) * octahedralDecode(aNormal);
+    Position = vec3(world * vec4(aPos, 1.0));
+    gl_Position = viewProjection * vec4(Position, 1.0);
+}
\ No newline at end of file
@@ -0,0 +1,317 @@
+#ifndef ASSET_BUNDLE_H
+#define ASSET_BUNDLE_H
+
+#include "fnv_hash.h"
+#include "mapped_file.h"
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+// many assets packed into one file, found by name through a hash table. each
+// asset is stored once however many names point at it (identical files share
+// their bytes) and starts on a 16 byte boundary.
+//
+//   AssetBundleHeader
+//   AssetRecord[slotCount]   open addressing on fnv1a64(name), linear probing
+//   char names[]             not terminated, see AssetRecord::nameLength
+//   asset data
+const unsigned int BUNDLE_MAGIC = 0x444E4241; // "ABND"
+const unsigned int BUNDLE_VERSION = 1;
+
+struct AssetBundleHeader {
+    unsigned int magic;
+    unsigned int version;
+    unsigned int assetCount;
+    unsigned int slotCount; // a power of two, at least twice assetCount
+    unsigned long long recordOffset;
+    unsigned long long nameOffset;
+    unsigned long long nameSize;
+    unsigned long long dataSize; // everything from the end of the names on
+};
+
+// one slot of the hash table; nameLength 0 marks an empty slot
+struct AssetRecord {
+    unsigned long long nameHash;
+    unsigned long long offset; // from the start of the file
+    unsigned long long size;
+    unsigned int nameOffset;   // from the start of the names
+    unsigned int nameLength;
+};
+
+// an asset's bytes inside the mapping; data is NULL if there is no such asset
+struct AssetSpan {
+    const unsigned char* data;
+    size_t size;
+};
+
+inline unsigned long long hashAssetName(const std::string& name)
+{
+    return fnv1a64((const unsigned char*)name.data(), name.size());
+}
+
+inline unsigned long long alignBundleOffset(unsigned long long offset)
+{
+    return (offset + 15) & ~15ULL;
+}
+
+// collects assets and writes them as a bundle
+class AssetBundleWriter
+{
+public:
+    AssetBundleWriter() : duplicates(0)
+    {
+    }
+
+    // adds an asset under name; contents already added under another name
+    // are stored once. false if the name is taken
+    // ------------------------------------------------------------------------
+    bool add(const std::string& name, const std::vector<unsigned char>& contents)
+    {
+        if (name.empty() || names.count(name))
+            return false;
+        unsigned long long hash = fnv1a64(contents.empty() ? NULL : &contents[0], contents.size());
+        std::multimap<unsigned long long, size_t>::iterator it = blobsByHash.lower_bound(hash);
+        for (; it != blobsByHash.end() && it->first == hash; ++it)
+        {
+            if (blobs[it->second] == contents)
+            {
+                names[name] = it->second;
+                duplicates++;
+                return true;
+            }
+        }
+        blobs.push_back(contents);
+        blobsByHash.insert(std::make_pair(hash, blobs.size() - 1));
+        names[name] = blobs.size() - 1;
+        return true;
+    }
+
+    bool write(const std::string& path) const
+    {
+        AssetBundleHeader header;
+        memset(&header, 0, sizeof(header));
+        header.magic = BUNDLE_MAGIC;
+        header.version = BUNDLE_VERSION;
+        header.assetCount = (unsigned int)names.size();
+        header.slotCount = 16;
+        while (header.slotCount < header.assetCount * 2)
+            header.slotCount *= 2;
+        header.recordOffset = sizeof(AssetBundleHeader);
+        header.nameOffset = header.recordOffset + header.slotCount * sizeof(AssetRecord);
+
+        std::string nameData;
+        for (const std::pair<const std::string, size_t>& name : names)
+            nameData += name.first;
+        header.nameSize = nameData.size();
+
+        // place the blobs after the names
+        std::vector<unsigned long long> blobOffsets;
+        unsigned long long end = header.nameOffset + header.nameSize;
+        for (const std::vector<unsigned char>& blob : blobs)
+        {
+            end = alignBundleOffset(end);
+            blobOffsets.push_back(end);
+            end += blob.size();
+        }
+        header.dataSize = end - (header.nameOffset + header.nameSize);
+
+        std::vector<AssetRecord> records(header.slotCount);
+        memset(&records[0], 0, records.size() * sizeof(AssetRecord));
+        unsigned int nameOffset = 0;
+        for (const std::pair<const std::string, size_t>& name : names)
+        {
+            AssetRecord record;
+            record.nameHash = hashAssetName(name.first);
+            record.offset = blobOffsets[name.second];
+            record.size = blobs[name.second].size();
+            record.nameOffset = nameOffset;
+            record.nameLength = (unsigned int)name.first.size();
+            nameOffset += record.nameLength;
+            unsigned int slot = (unsigned int)record.nameHash & (header.slotCount - 1);
+            while (records[slot].nameLength)
+                slot = (slot + 1) & (header.slotCount - 1);
+            records[slot] = record;
+        }
+
+        std::ofstream file(path.c_str(), std::ios::binary);
+        file.write((const char*)&header, sizeof(header));
+        file.write((const char*)&records[0], (std::streamsize)(records.size() * sizeof(AssetRecord)));
+        file.write(nameData.data(), (std::streamsize)nameData.size());
+        const char padding[16] = { 0 };
+        unsigned long long written = header.nameOffset + header.nameSize;
+        for (size_t i = 0; i < blobs.size(); ++i)
+        {
+            file.write(padding, (std::streamsize)(blobOffsets[i] - written));
+            if (!blobs[i].empty())
+                file.write((const char*)&blobs[i][0], (std::streamsize)blobs[i].size());
+            written = blobOffsets[i] + blobs[i].size();
+        }
+        if (!file)
+        {
+            std::cout << "Failed to write asset bundle: " << path << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    size_t assetCount() const
+    {
+        return names.size();
+    }
+
+    // names that share the contents of an earlier one
+    size_t duplicateCount() const
+    {
+        return duplicates;
+    }
+
+    size_t uniqueBytes() const
+    {
+        size_t bytes = 0;
+        for (const std::vector<unsigned char>& blob : blobs)
+            bytes += blob.size();
+        return bytes;
+    }
+
+private:
+    std::map<std::string, size_t> names; // name -> index into blobs
+    std::vector<std::vector<unsigned char> > blobs;
+    std::multimap<unsigned long long, size_t> blobsByHash;
+    size_t duplicates;
+};
+
+// a bundle mapped into memory. find() hands out spans into the mapping, so an
+// asset is never read into a buffer of its own: the decoder reads the pages
+// it touches straight from the page cache
+class AssetBundle
+{
+public:
+    AssetBundle() : header(NULL), records(NULL), names(NULL)
+    {
+    }
+
+    // maps and validates the bundle. paths that start with root are looked up
+    // without it, e.g. root FileSystem::getPath("") turns absolute texture
+    // paths back into the names the packer stored
+    // ------------------------------------------------------------------------
+    bool open(const std::string& path, const std::string& root = std::string())
+    {
+        close();
+        if (!file.open(path.c_str()))
+        {
+            std::cout << "Failed to open asset bundle: " << path << std::endl;
+            return false;
+        }
+        const AssetBundleHeader* candidate = (const AssetBundleHeader*)file.data;
+        if (file.size < sizeof(AssetBundleHeader) || candidate->magic != BUNDLE_MAGIC || candidate->version != BUNDLE_VERSION ||
+            candidate->slotCount == 0 || (candidate->slotCount & (candidate->slotCount - 1)) != 0 ||
+            candidate->assetCount >= candidate->slotCount ||
+            !fits(candidate->recordOffset, (unsigned long long)candidate->slotCount * sizeof(AssetRecord)) ||
+            !fits(candidate->nameOffset, candidate->nameSize))
+        {
+            std::cout << "Not a valid asset bundle: " << path << std::endl;
+            close();
+            return false;
+        }
+        header = candidate;
+        records = (const AssetRecord*)(file.data + header->recordOffset);
+        names = (const char*)(file.data + header->nameOffset);
+        unsigned int used = 0;
+        for (unsigned int slot = 0; slot < header->slotCount; ++slot)
+        {
+            const AssetRecord& record = records[slot];
+            used += record.nameLength ? 1 : 0;
+            if (record.nameLength && (!fits(record.offset, record.size) ||
+                (unsigned long long)record.nameOffset + record.nameLength > header->nameSize))
+            {
+                std::cout << "Asset " << slot << " is out of range in " << path << std::endl;
+                close();
+                return false;
+            }
+        }
+        if (used == header->slotCount)
+        {
+            // find() stops at the first empty slot
+            std::cout << "Asset bundle has a full table: " << path << std::endl;
+            close();
+            return false;
+        }
+        this->root = root;
+        return true;
+    }
+
+    bool isOpen() const
+    {
+        return header != NULL;
+    }
+
+    // the asset stored under path (minus the root); data is NULL if there is none
+    // ------------------------------------------------------------------------
+    AssetSpan find(const std::string& path) const
+    {
+        AssetSpan span = { NULL, 0 };
+        if (!header)
+            return span;
+        std::string name = !root.empty() && path.compare(0, root.size(), root) == 0 ? path.substr(root.size()) : path;
+        unsigned long long hash = hashAssetName(name);
+        for (unsigned int slot = (unsigned int)hash & (header->slotCount - 1);; slot = (slot + 1) & (header->slotCount - 1))
+        {
+            const AssetRecord& record = records[slot];
+            if (!record.nameLength)
+                return span;
+            if (record.nameHash == hash && record.nameLength == name.size() && memcmp(names + record.nameOffset, name.data(), name.size()) == 0)
+            {
+                span.data = file.data + record.offset;
+                span.size = (size_t)record.size;
+                return span;
+            }
+        }
+    }
+
+    size_t size() const
+    {
+        return header ? header->assetCount : 0;
+    }
+
+    void close()
+    {
+        file.close();
+        header = NULL;
+        records = NULL;
+        names = NULL;
+    }
+
+private:
+    MappedFile file;
+    std::string root;
+    const AssetBundleHeader* header;
+    const AssetRecord* records;
+    const char* names;
+
+    bool fits(unsigned long long offset, unsigned long long size) const
+    {
+        return offset <= file.size && size <= file.size - offset;
+    }
+};
+
+// the bundle the loaders read from before falling back to the file system;
+// NULL until the application mounts one
+// ---------------------------------------------------------------------------
+inline const AssetBundle*& mountedAssetBundle()
+{
+    static const AssetBundle* bundle = NULL;
+    return bundle;
+}
+
+inline AssetSpan findAsset(const std::string& path)
+{
+    const AssetBundle* bundle = mountedAssetBundle();
+    AssetSpan span = { NULL, 0 };
+    return bundle ? bundle->find(path) : span;
+}
+
+#endif
@@ -0,0 +1,105 @@
+// packs textures, compiled textures and shaders into one asset bundle (see
+// asset_bundle.h) that the renderer maps with --bundle <file> instead of
+// opening every file on its own. files with identical contents are stored once.
+//
+// usage: asset_packer <out.bundle> [--root <dir>] <file or dir>...
+//   --root <dir>   names of files below dir are stored relative to it, the
+//                  way the renderer asks for them through FileSystem::getPath;
+//                  point it at the LearnOpenGL root. every other file keeps
+//                  the path it was given, e.g. shaders next to the executable
+//   directories are packed with everything below them
+//
+// e.g. from the chapter's build directory
+//   asset_packer assets.bundle --root <root> <root>/resources/textures *.vs *.fs
+//
+// it is its own executable next to the chapter, no GL or stb_image needed:
+//   g++ -std=c++17 -O2 -I<includes> asset_packer.cpp -o asset_packer
+#include "asset_bundle.h"
+
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+// the name the renderer will look the file up by
+// -----------------------------------------------
+std::string assetName(const fs::path& file, const fs::path& root)
+{
+    if (!root.empty())
+    {
+        fs::path relative = fs::absolute(file).lexically_normal().lexically_relative(root);
+        if (!relative.empty() && *relative.begin() != "..")
+            return relative.generic_string();
+    }
+    return file.generic_string();
+}
+
+bool packFile(AssetBundleWriter& writer, const fs::path& file, const fs::path& root)
+{
+    std::ifstream stream(file, std::ios::binary);
+    std::vector<unsigned char> contents((std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
+    if (!stream.good() && !stream.eof())
+    {
+        std::cout << "Failed to read " << file.string() << std::endl;
+        return false;
+    }
+    std::string name = assetName(file, root);
+    if (!writer.add(name, contents))
+    {
+        std::cout << "Skipping " << file.string() << ", already packed as " << name << std::endl;
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc < 3)
+    {
+        std::cout << "usage: asset_packer <out.bundle> [--root <dir>] <file or dir>..." << std::endl;
+        return 1;
+    }
+    std::string target = argv[1];
+    fs::path root;
+    std::vector<fs::path> inputs;
+    for (int i = 2; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg == "--root" && i + 1 < argc)
+            root = fs::absolute(argv[++i]).lexically_normal();
+        else
+            inputs.push_back(arg);
+    }
+
+    AssetBundleWriter writer;
+    int failed = 0;
+    for (const fs::path& input : inputs)
+    {
+        if (fs::is_directory(input))
+        {
+            for (const fs::directory_entry& entry : fs::recursive_directory_iterator(input))
+                if (entry.is_regular_file() && !packFile(writer, entry.path(), root))
+                    failed++;
+        }
+        else if (fs::is_regular_file(input))
+        {
+            if (!packFile(writer, input, root))
+                failed++;
+        }
+        else
+        {
+            std::cout << "No such file or directory: " << input.string() << std::endl;
+            failed++;
+        }
+    }
+
+    if (!writer.write(target))
+        return 1;
+    std::cout << target << ": " << writer.assetCount() << " assets, " << writer.duplicateCount() << " duplicates stored once, "
+              << writer.uniqueBytes() / 1024 << " KB" << std::endl;
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,222 @@
+#ifndef BC_COMPRESS_H
+#define BC_COMPRESS_H
+
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+// BC1 / BC3 block compression for the offline texture compiler. endpoints are
+// the extremes of the block's colors along their principal axis, which is
+// close to what dedicated compressors do and fast enough for a build step.
+
+inline unsigned short packRGB565(const float* color)
+{
+    int r = (int)(color[0] * 31.0f / 255.0f + 0.5f);
+    int g = (int)(color[1] * 63.0f / 255.0f + 0.5f);
+    int b = (int)(color[2] * 31.0f / 255.0f + 0.5f);
+    r = r < 0 ? 0 : (r > 31 ? 31 : r);
+    g = g < 0 ? 0 : (g > 63 ? 63 : g);
+    b = b < 0 ? 0 : (b > 31 ? 31 : b);
+    return (unsigned short)((r << 11) | (g << 5) | b);
+}
+
+inline void unpackRGB565(unsigned short packed, int* color)
+{
+    int r = (packed >> 11) & 31, g = (packed >> 5) & 63, b = packed & 31;
+    color[0] = (r << 3) | (r >> 2);
+    color[1] = (g << 2) | (g >> 4);
+    color[2] = (b << 3) | (b >> 2);
+}
+
+// compresses 16 RGBA pixels (row-major 4x4) into an 8 byte BC1 block; alpha is ignored
+// ------------------------------------------------------------------------------------
+inline void compressBC1Block(const unsigned char* pixels, unsigned char* block)
+{
+    // mean and covariance of the colors
+    float mean[3] = { 0.0f, 0.0f, 0.0f };
+    for (int i = 0; i < 16; ++i)
+        for (int c = 0; c < 3; ++c)
+            mean[c] += pixels[i * 4 + c] / 16.0f;
+    float cov[6] = { 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f };
+    for (int i = 0; i < 16; ++i)
+    {
+        float r = pixels[i * 4 + 0] - mean[0], g = pixels[i * 4 + 1] - mean[1], b = pixels[i * 4 + 2] - mean[2];
+        cov[0] += r * r; cov[1] += r * g; cov[2] += r * b;
+        cov[3] += g * g; cov[4] += g * b; cov[5] += b * b;
+    }
+
+    // principal axis by power iteration
+    float axis[3] = { 1.0f, 1.0f, 1.0f };
+    for (int iteration = 0; iteration < 8; ++iteration)
+    {
+        float x = cov[0] * axis[0] + cov[1] * axis[1] + cov[2] * axis[2];
+        float y = cov[1] * axis[0] + cov[3] * axis[1] + cov[4] * axis[2];
+        float z = cov[2] * axis[0] + cov[4] * axis[1] + cov[5] * axis[2];
+        float length = std::sqrt(x * x + y * y + z * z);
+        if (length < 1e-6f)
+            break;
+        axis[0] = x / length; axis[1] = y / length; axis[2] = z / length;
+    }
+
+    // the extreme projections become the endpoints
+    float minT = 1e30f, maxT = -1e30f;
+    for (int i = 0; i < 16; ++i)
+    {
+        float t = (pixels[i * 4 + 0] - mean[0]) * axis[0] + (pixels[i * 4 + 1] - mean[1]) * axis[1] + (pixels[i * 4 + 2] - mean[2]) * axis[2];
+        minT = t < minT ? t : minT;
+        maxT = t > maxT ? t : maxT;
+    }
+    float high[3], low[3];
+    for (int c = 0; c < 3; ++c)
+    {
+        high[c] = mean[c] + axis[c] * maxT;
+        low[c] = mean[c] + axis[c] * minT;
+    }
+    unsigned short color0 = packRGB565(high), color1 = packRGB565(low);
+    if (color0 < color1)
+    {
+        unsigned short swap = color0;
+        color0 = color1;
+        color1 = swap;
+    }
+
+    // four color mode needs color0 > color1; a flat block uses index 0 only
+    unsigned int indices = 0;
+    if (color0 != color1)
+    {
+        int palette[4][3];
+        unpackRGB565(color0, palette[0]);
+        unpackRGB565(color1, palette[1]);
+        for (int c = 0; c < 3; ++c)
+        {
+            palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+            palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+        }
+        for (int i = 0; i < 16; ++i)
+        {
+            int best = 0, bestError = 1 << 30;
+            for (int p = 0; p < 4; ++p)
+            {
+                int dr = pixels[i * 4 + 0] - palette[p][0], dg = pixels[i * 4 + 1] - palette[p][1], db = pixels[i * 4 + 2] - palette[p][2];
+                int error = dr * dr + dg * dg + db * db;
+                if (error < bestError)
+                {
+                    bestError = error;
+                    best = p;
+                }
+            }
+            indices |= (unsigned int)best << (i * 2);
+        }
+    }
+    block[0] = color0 & 0xFF;
+    block[1] = color0 >> 8;
+    block[2] = color1 & 0xFF;
+    block[3] = color1 >> 8;
+    for (int i = 0; i < 4; ++i)
+        block[4 + i] = (indices >> (i * 8)) & 0xFF;
+}
+
+// 8 byte BC4-style alpha block used by BC3
+// ----------------------------------------
+inline void compressAlphaBlock(const unsigned char* pixels, unsigned char* block)
+{
+    int alpha0 = 0, alpha1 = 255;
+    for (int i = 0; i < 16; ++i)
+    {
+        int a = pixels[i * 4 + 3];
+        alpha0 = a > alpha0 ? a : alpha0;
+        alpha1 = a < alpha1 ? a : alpha1;
+    }
+    unsigned long long indices = 0;
+    if (alpha0 != alpha1)
+    {
+        // eight level mode: alpha0 > alpha1
+        int palette[8] = { alpha0, alpha1 };
+        for (int p = 1; p < 7; ++p)
+            palette[p + 1] = ((7 - p) * alpha0 + p * alpha1) / 7;
+        for (int i = 0; i < 16; ++i)
+        {
+            int best = 0, bestError = 1 << 30;
+            for (int p = 0; p < 8; ++p)
+            {
+                int error = std::abs(pixels[i * 4 + 3] - palette[p]);
+                if (error < bestError)
+                {
+                    bestError = error;
+                    best = p;
+                }
+            }
+            indices |= (unsigned long long)best << (i * 3);
+        }
+    }
+    block[0] = (unsigned char)alpha0;
+    block[1] = (unsigned char)alpha1;
+    for (int i = 0; i < 6; ++i)
+        block[2 + i] = (indices >> (i * 8)) & 0xFF;
+}
+
+inline void compressBC3Block(const unsigned char* pixels, unsigned char* block)
+{
+    compressAlphaBlock(pixels, block);
+    compressBC1Block(pixels, block + 8);
+}
+
+// compresses a whole RGBA image; edge blocks repeat the last row / column
+// -----------------------------------------------------------------------
+inline std::vector<unsigned char> compressImage(const unsigned char* rgba, int width, int height, bool withAlpha)
+{
+    size_t blockSize = withAlpha ? 16 : 8;
+    int blocksX = (width + 3) / 4, blocksY = (height + 3) / 4;
+    std::vector<unsigned char> result(blocksX * blocksY * blockSize);
+    unsigned char pixels[64];
+    for (int by = 0; by < blocksY; ++by)
+    {
+        for (int bx = 0; bx < blocksX; ++bx)
+        {
+            for (int y = 0; y < 4; ++y)
+            {
+                int sy = by * 4 + y < height ? by * 4 + y : height - 1;
+                for (int x = 0; x < 4; ++x)
+                {
+                    int sx = bx * 4 + x < width ? bx * 4 + x : width - 1;
+                    memcpy(pixels + (y * 4 + x) * 4, rgba + ((size_t)sy * width + sx) * 4, 4);
+                }
+            }
+            unsigned char* block = &result[(by * blocksX + bx) * blockSize];
+            if (withAlpha)
+                compressBC3Block(pixels, block);
+            else
+                compressBC1Block(pixels, block);
+        }
+    }
+    return result;
+}
+
+// halves an RGBA image with a 2x2 box filter (odd edges reuse the last texel)
+// ----------------------------------------------------------------------------
+inline std::vector<unsigned char> downsampleRGBA(const unsigned char* rgba, int width, int height, int& outWidth, int& outHeight)
+{
+    outWidth = width > 1 ? width / 2 : 1;
+    outHeight = height > 1 ? height / 2 : 1;
+    std::vector<unsigned char> result((size_t)outWidth * outHeight * 4);
+    for (int y = 0; y < outHeight; ++y)
+    {
+        int y0 = y * 2 < height ? y * 2 : height - 1;
+        int y1 = y * 2 + 1 < height ? y * 2 + 1 : height - 1;
+        for (int x = 0; x < outWidth; ++x)
+        {
+            int x0 = x * 2 < width ? x * 2 : width - 1;
+            int x1 = x * 2 + 1 < width ? x * 2 + 1 : width - 1;
+            for (int c = 0; c < 4; ++c)
+            {
+                int sum = rgba[((size_t)y0 * width + x0) * 4 + c] + rgba[((size_t)y0 * width + x1) * 4 + c] +
+                          rgba[((size_t)y1 * width + x0) * 4 + c] + rgba[((size_t)y1 * width + x1) * 4 + c];
+                result[((size_t)y * outWidth + x) * 4 + c] = (unsigned char)((sum + 2) / 4);
+            }
+        }
+    }
+    return result;
+}
+
+#endif
@@ -0,0 +1,112 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <learnopengl/camera.h>
+
+#include "fnv_hash.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+#include <vector>
+
+// a color + depth framebuffer the benchmark renders into instead of a window
+class OffscreenTarget
+{
+public:
+    unsigned int FBO;
+    unsigned int colorRBO;
+    unsigned int depthRBO;
+    int width;
+    int height;
+
+    OffscreenTarget() : FBO(0), colorRBO(0), depthRBO(0), width(0), height(0)
+    {
+    }
+
+    bool create(int w, int h)
+    {
+        width = w;
+        height = h;
+        glGenFramebuffers(1, &FBO);
+        glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+        glGenRenderbuffers(1, &colorRBO);
+        glBindRenderbuffer(GL_RENDERBUFFER, colorRBO);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorRBO);
+        glGenRenderbuffers(1, &depthRBO);
+        glBindRenderbuffer(GL_RENDERBUFFER, depthRBO);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, depthRBO);
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        {
+            std::cout << "ERROR::FRAMEBUFFER:: Framebuffer is not complete!" << std::endl;
+            return false;
+        }
+        glViewport(0, 0, width, height);
+        return true;
+    }
+
+    // reads the color attachment back as tightly packed RGBA
+    // ------------------------------------------------------------------------
+    std::vector<unsigned char> readPixels() const
+    {
+        std::vector<unsigned char> pixels(width * height * 4);
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, FBO);
+        glPixelStorei(GL_PACK_ALIGNMENT, 1);
+        glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, &pixels[0]);
+        return pixels;
+    }
+
+    void release()
+    {
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glDeleteFramebuffers(1, &FBO);
+        glDeleteRenderbuffers(1, &colorRBO);
+        glDeleteRenderbuffers(1, &depthRBO);
+    }
+};
+
+// places the camera on a fixed orbit around the compound; frame / frameCount
+// gives the position along the path so every run sees the same views
+// ---------------------------------------------------------------------------
+inline void benchmarkCamera(Camera& camera, int frame, int frameCount)
+{
+    float t = frameCount > 1 ? (float)frame / (float)(frameCount - 1) : 0.0f;
+    float angle = t * 2.0f * 3.14159265359f;
+    float radius = 4.0f - 2.0f * t; // spiral in towards the dome
+    camera.Position = glm::vec3(radius * std::cos(angle), 0.2f, radius * std::sin(angle));
+    // look back at the centre of the compound
+    camera.Yaw = glm::degrees(std::atan2(-camera.Position.z, -camera.Position.x));
+    camera.Pitch = -10.0f;
+    camera.Zoom = 45.0f;
+    camera.ProcessMouseMovement(0.0f, 0.0f); // recomputes the camera vectors
+}
+
+// prints frames per second and frame time percentiles (milliseconds)
+// ------------------------------------------------------------------
+inline void printBenchmark(std::vector<double> frameTimes, unsigned long long imageHash)
+{
+    if (frameTimes.empty())
+        return;
+    double total = 0.0;
+    for (double ms : frameTimes)
+        total += ms;
+    std::sort(frameTimes.begin(), frameTimes.end());
+    size_t last = frameTimes.size() - 1;
+    char hash[17];
+    std::snprintf(hash, sizeof(hash), "%016llx", imageHash);
+    std::cout << "bench: " << frameTimes.size() << " frames in " << total / 1000.0 << " s, "
+              << frameTimes.size() * 1000.0 / total << " fps" << std::endl;
+    std::cout << "bench: frame time p50 " << frameTimes[(size_t)(0.50 * last + 0.5)]
+              << " p90 " << frameTimes[(size_t)(0.90 * last + 0.5)]
+              << " p99 " << frameTimes[(size_t)(0.99 * last + 0.5)]
+              << " max " << frameTimes[last] << " ms" << std::endl;
+    std::cout << "bench: image hash " << hash << std::endl;
+}
+
+#endif
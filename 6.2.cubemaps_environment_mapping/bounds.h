@@ -0,0 +1,72 @@
+#ifndef BOUNDS_H
+#define BOUNDS_H
+
+#include <glm/glm.hpp>
+
+#include "static_geometry.h"
+
+#include <cmath>
+
+// a sphere around an object, in whatever space its center is given in
+struct BoundingSphere {
+    glm::vec3 center;
+    float radius;
+};
+
+// the sphere around the box of one range's positions (floats 0-2 of a vertex)
+// ---------------------------------------------------------------------------
+inline BoundingSphere computeBoundingSphere(const float* vertices, unsigned int floatsPerVertex, const DrawRange& range)
+{
+    glm::vec3 low(vertices[range.firstVertex * floatsPerVertex]);
+    glm::vec3 high = low;
+    for (unsigned int v = range.firstVertex; v < range.firstVertex + range.vertexCount; ++v)
+    {
+        glm::vec3 position(vertices[v * floatsPerVertex], vertices[v * floatsPerVertex + 1], vertices[v * floatsPerVertex + 2]);
+        low = glm::min(low, position);
+        high = glm::max(high, position);
+    }
+    BoundingSphere sphere = { (low + high) * 0.5f, glm::length(high - low) * 0.5f };
+    return sphere;
+}
+
+// moves a sphere by a model matrix; the radius grows with the largest scale
+// ---------------------------------------------------------------------------
+inline BoundingSphere transformSphere(const glm::mat4& model, const BoundingSphere& sphere)
+{
+    float scale = glm::max(glm::length(glm::vec3(model[0])), glm::max(glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2]))));
+    BoundingSphere result = { glm::vec3(model * glm::vec4(sphere.center, 1.0f)), sphere.radius * scale };
+    return result;
+}
+
+// the six planes of a view frustum, pointing inwards
+class Frustum
+{
+public:
+    // extracts the planes from a projection * view matrix
+    // ------------------------------------------------------------------------
+    Frustum(const glm::mat4& viewProjection)
+    {
+        glm::mat4 m = glm::transpose(viewProjection);
+        planes[0] = m[3] + m[0]; // left
+        planes[1] = m[3] - m[0]; // right
+        planes[2] = m[3] + m[1]; // bottom
+        planes[3] = m[3] - m[1]; // top
+        planes[4] = m[3] + m[2]; // near
+        planes[5] = m[3] - m[2]; // far
+        for (glm::vec4& plane : planes)
+            plane /= glm::length(glm::vec3(plane));
+    }
+
+    bool intersects(const BoundingSphere& sphere) const
+    {
+        for (const glm::vec4& plane : planes)
+            if (glm::dot(glm::vec3(plane), sphere.center) + plane.w < -sphere.radius)
+                return false;
+        return true;
+    }
+
+private:
+    glm::vec4 planes[6];
+};
+
+#endif
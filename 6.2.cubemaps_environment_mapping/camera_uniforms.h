@@ -0,0 +1,71 @@
+#ifndef CAMERA_UNIFORMS_H
+#define CAMERA_UNIFORMS_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "shader_cache.h"
+
+// mirrors the std140 "Camera" uniform block declared in the vertex shaders
+struct CameraBlock {
+    glm::mat4 view;
+    glm::mat4 projection;
+    glm::mat4 viewProjection;
+    glm::vec4 cameraPosition; // w unused, keeps the std140 vec4 alignment explicit
+};
+
+// one uniform buffer with the per-frame camera matrices, bound to a fixed
+// binding point that every program's "Camera" block is attached to
+class CameraUniforms
+{
+public:
+    static const unsigned int BINDING = 0;
+    unsigned int UBO;
+
+    CameraUniforms() : UBO(0)
+    {
+    }
+
+    // allocates the buffer and attaches it to the binding point
+    // ------------------------------------------------------------------------
+    void create()
+    {
+        glGenBuffers(1, &UBO);
+        glBindBuffer(GL_UNIFORM_BUFFER, UBO);
+        glBufferData(GL_UNIFORM_BUFFER, sizeof(CameraBlock), NULL, GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+        glBindBufferBase(GL_UNIFORM_BUFFER, BINDING, UBO);
+    }
+
+    // points the program's Camera block at our binding; programs without the
+    // block are left alone
+    // ------------------------------------------------------------------------
+    void bind(const ShaderProgram& program) const
+    {
+        unsigned int blockIndex = glGetUniformBlockIndex(program.ID, "Camera");
+        if (blockIndex != GL_INVALID_INDEX)
+            glUniformBlockBinding(program.ID, blockIndex, BINDING);
+    }
+
+    // writes the whole block once per frame
+    // ------------------------------------------------------------------------
+    void update(const glm::mat4& view, const glm::mat4& projection, const glm::vec3& position)
+    {
+        CameraBlock block;
+        block.view = view;
+        block.projection = projection;
+        block.viewProjection = projection * view;
+        block.cameraPosition = glm::vec4(position, 1.0f);
+        glBindBuffer(GL_UNIFORM_BUFFER, UBO);
+        glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(CameraBlock), &block);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    }
+
+    void release()
+    {
+        glDeleteBuffers(1, &UBO);
+        UBO = 0;
+    }
+};
+
+#endif
@@ -0,0 +1,103 @@
+#ifndef COMPRESSED_TEXTURE_H
+#define COMPRESSED_TEXTURE_H
+
+#include <glad/glad.h>
+
+#include "dds_file.h"
+
+#include <sys/stat.h>
+
+#include <cstring>
+#include <string>
+
+// S3TC is an extension to the 3.3 core profile our glad is generated for
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+
+inline bool hasGLExtension(const char* name)
+{
+    GLint count = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+    for (GLint i = 0; i < count; ++i)
+    {
+        const char* extension = (const char*)glGetStringi(GL_EXTENSIONS, i);
+        if (extension && strcmp(extension, name) == 0)
+            return true;
+    }
+    return false;
+}
+
+inline bool supportsS3TC()
+{
+    static int supported = -1;
+    if (supported < 0)
+        supported = hasGLExtension("GL_EXT_texture_compression_s3tc") ? 1 : 0;
+    return supported == 1;
+}
+
+// the compiled container texture_compiler writes next to a source image
+// ----------------------------------------------------------------------
+inline std::string compiledTexturePath(const std::string& path)
+{
+    return path + ".dds";
+}
+
+// false when the source image was saved after its compiled file was
+// written, e.g. while editing textures with hot reload on
+// ------------------------------------------------------------------------
+inline bool compiledTextureIsCurrent(const std::string& path)
+{
+    if (findAsset(compiledTexturePath(path)).data)
+        return true; // the bundle was packed from one build of the textures
+    struct stat source, compiled;
+    if (stat(path.c_str(), &source) != 0 || stat(compiledTexturePath(path).c_str(), &compiled) != 0)
+        return true; // no source to compare against; the compiled file is all there is
+    return compiled.st_mtime >= source.st_mtime;
+}
+
+// uploads every mip level of a compressed image to the bound texture's target
+// ----------------------------------------------------------------------------
+inline void uploadCompressedLevels(GLenum target, const DDSImage& image)
+{
+    GLenum format = image.fourCC == DDS_DXT1 ? GL_COMPRESSED_RGB_S3TC_DXT1_EXT : GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+    for (unsigned int level = 0; level < image.levels.size(); ++level)
+    {
+        const DDSLevel& mip = image.levels[level];
+        glCompressedTexImage2D(target, level, format, mip.width, mip.height, 0, (GLsizei)mip.size, &image.data[mip.offset]);
+    }
+}
+
+// reads the compiled version of an image if there is one that is up to date,
+// matches the requested orientation and the driver can sample
+// ------------------------------------------------------------------------
+inline bool readCompiledTexture(const std::string& path, bool flip, DDSImage& image)
+{
+    return supportsS3TC() && compiledTextureIsCurrent(path) && readDDS(compiledTexturePath(path), image) && image.faces == 1 && image.flipped == flip;
+}
+
+// loads the compiled version of an image as a 2D texture with its stored mips;
+// returns 0 when there is none, so the caller can decode the source instead
+// ------------------------------------------------------------------------
+inline unsigned int loadCompiledTexture(const std::string& path, bool flip)
+{
+    DDSImage image;
+    if (!readCompiledTexture(path, flip, image))
+        return 0;
+
+    unsigned int textureID;
+    glGenTextures(1, &textureID);
+    glBindTexture(GL_TEXTURE_2D, textureID);
+    uploadCompressedLevels(GL_TEXTURE_2D, image);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, (GLint)image.levels.size() - 1);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    return textureID;
+}
+
+#endif
@@ -0,0 +1,298 @@
+#ifndef CUBEMAP_LOADER_H
+#define CUBEMAP_LOADER_H
+
+#include <glad/glad.h>
+
+#include "compressed_texture.h"
+#include "dds_file.h"
+#include "image_decode.h"
+#include "thread_pool.h"
+
+#include <cmath>
+#include <cstring>
+#include <future>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// how the six faces of a cubemap are stored in the source image(s)
+enum CubemapLayout {
+    CUBEMAP_SEPARATE_FACES,  // six files, +X -X +Y -Y +Z -Z
+    CUBEMAP_HORIZONTAL_CROSS, // 4x3 cells:    +Y / -X +Z +X -Z / -Y
+    CUBEMAP_VERTICAL_CROSS,   // 3x4 cells:    +Y / -X +Z +X / -Y / -Z (upside down)
+    CUBEMAP_EQUIRECTANGULAR   // 2:1 latitude / longitude panorama
+};
+
+// guesses the layout of a single image from its aspect ratio
+// ----------------------------------------------------------
+inline bool detectCubemapLayout(int width, int height, CubemapLayout& layout)
+{
+    if (width * 3 == height * 4)
+        layout = CUBEMAP_HORIZONTAL_CROSS;
+    else if (width * 4 == height * 3)
+        layout = CUBEMAP_VERTICAL_CROSS;
+    else if (width == height * 2)
+        layout = CUBEMAP_EQUIRECTANGULAR;
+    else
+        return false;
+    return true;
+}
+
+inline int cubemapFaceSize(const DecodedImage& image, CubemapLayout layout)
+{
+    if (layout == CUBEMAP_HORIZONTAL_CROSS)
+        return image.width / 4;
+    if (layout == CUBEMAP_VERTICAL_CROSS)
+        return image.width / 3;
+    return image.width / 4; // equirectangular: keeps about the source's texel density
+}
+
+// copies one face out of a cross layout as RGBA
+// ---------------------------------------------
+inline std::vector<unsigned char> extractCrossFace(const DecodedImage& image, CubemapLayout layout, int face, int size)
+{
+    // cell (column, row) of every face in the cross
+    static const int horizontal[6][2] = { { 2, 1 }, { 0, 1 }, { 1, 0 }, { 1, 2 }, { 1, 1 }, { 3, 1 } };
+    static const int vertical[6][2] = { { 2, 1 }, { 0, 1 }, { 1, 0 }, { 1, 2 }, { 1, 1 }, { 1, 3 } };
+    const int* cell = layout == CUBEMAP_HORIZONTAL_CROSS ? horizontal[face] : vertical[face];
+    // the back face of a vertical cross hangs below the bottom face, rotated by 180 degrees
+    bool rotated = layout == CUBEMAP_VERTICAL_CROSS && face == 5;
+
+    std::vector<unsigned char> pixels((size_t)size * size * 4);
+    for (int y = 0; y < size; ++y)
+    {
+        for (int x = 0; x < size; ++x)
+        {
+            int sx = rotated ? size - 1 - x : x;
+            int sy = rotated ? size - 1 - y : y;
+            const unsigned char* src = image.data + ((size_t)(cell[1] * size + sy) * image.width + cell[0] * size + sx) * 4;
+            memcpy(&pixels[((size_t)y * size + x) * 4], src, 4);
+        }
+    }
+    return pixels;
+}
+
+// the direction a texel of a cube face looks at, following the GL face orientations
+// ---------------------------------------------------------------------------------
+inline void cubemapDirection(int face, float s, float t, float* direction)
+{
+    switch (face)
+    {
+    case 0: direction[0] = 1.0f; direction[1] = -t; direction[2] = -s; break;
+    case 1: direction[0] = -1.0f; direction[1] = -t; direction[2] = s; break;
+    case 2: direction[0] = s; direction[1] = 1.0f; direction[2] = t; break;
+    case 3: direction[0] = s; direction[1] = -1.0f; direction[2] = -t; break;
+    case 4: direction[0] = s; direction[1] = -t; direction[2] = 1.0f; break;
+    default: direction[0] = -s; direction[1] = -t; direction[2] = -1.0f; break;
+    }
+}
+
+// resamples one face out of an equirectangular panorama (bilinear, RGBA)
+// ---------------------------------------------------------------------
+inline std::vector<unsigned char> projectEquirectangularFace(const DecodedImage& image, int face, int size)
+{
+    const float PI = 3.14159265359f;
+    std::vector<unsigned char> pixels((size_t)size * size * 4);
+    for (int y = 0; y < size; ++y)
+    {
+        for (int x = 0; x < size; ++x)
+        {
+            float direction[3];
+            cubemapDirection(face, 2.0f * (x + 0.5f) / size - 1.0f, 2.0f * (y + 0.5f) / size - 1.0f, direction);
+            float length = std::sqrt(direction[0] * direction[0] + direction[1] * direction[1] + direction[2] * direction[2]);
+            float u = 0.5f + std::atan2(direction[2], direction[0]) / (2.0f * PI);
+            float v = std::acos(direction[1] / length) / PI;
+
+            float fx = u * image.width - 0.5f, fy = v * image.height - 0.5f;
+            int x0 = (int)std::floor(fx), y0 = (int)std::floor(fy);
+            float ax = fx - x0, ay = fy - y0;
+            for (int c = 0; c < 4; ++c)
+            {
+                float sample = 0.0f;
+                for (int j = 0; j < 2; ++j)
+                {
+                    // longitude wraps around, latitude clamps at the poles
+                    int sy = y0 + j < 0 ? 0 : (y0 + j >= image.height ? image.height - 1 : y0 + j);
+                    for (int i = 0; i < 2; ++i)
+                    {
+                        int sx = ((x0 + i) % image.width + image.width) % image.width;
+                        float weight = (i ? ax : 1.0f - ax) * (j ? ay : 1.0f - ay);
+                        sample += weight * image.data[((size_t)sy * image.width + sx) * 4 + c];
+                    }
+                }
+                pixels[((size_t)y * size + x) * 4 + c] = (unsigned char)(sample + 0.5f);
+            }
+        }
+    }
+    return pixels;
+}
+
+inline int mipLevelCount(int size)
+{
+    int levels = 1;
+    while (size > 1)
+    {
+        size /= 2;
+        levels++;
+    }
+    return levels;
+}
+
+// allocates every face and mip level at once: immutable storage when the
+// driver has ARB_texture_storage, otherwise the whole chain by hand so the
+// texture is complete no matter how the levels get filled in
+// ----------------------------------------------------------------------------
+inline void allocateCubemap(GLenum internalFormat, int size, int levels)
+{
+#ifdef GL_ARB_texture_storage
+    if (GLAD_GL_ARB_texture_storage)
+    {
+        glTexStorage2D(GL_TEXTURE_CUBE_MAP, levels, internalFormat, size, size);
+        return;
+    }
+#endif
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAX_LEVEL, levels - 1);
+    for (int level = 0; level < levels; ++level)
+    {
+        int levelSize = size >> level > 0 ? size >> level : 1;
+        for (int face = 0; face < 6; ++face)
+            glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, level, internalFormat, levelSize, levelSize, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    }
+}
+
+inline void setCubemapParameters(int levels)
+{
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, levels > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+}
+
+// uploads six square RGBA faces into immutable mipmapped storage
+// ---------------------------------------------------------------
+inline unsigned int createCubemap(const std::vector<std::vector<unsigned char> >& faces, int size)
+{
+    unsigned int textureID;
+    glGenTextures(1, &textureID);
+    glBindTexture(GL_TEXTURE_CUBE_MAP, textureID);
+    int levels = mipLevelCount(size);
+    allocateCubemap(GL_RGBA8, size, levels);
+    for (int face = 0; face < 6; ++face)
+        glTexSubImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, 0, 0, 0, size, size, GL_RGBA, GL_UNSIGNED_BYTE, &faces[face][0]);
+    glGenerateMipmap(GL_TEXTURE_CUBE_MAP);
+    setCubemapParameters(levels);
+    return textureID;
+}
+
+// uploads a compiled cube (six faces with their mips) without decoding anything
+// ------------------------------------------------------------------------------
+inline unsigned int createCompressedCubemap(const DDSImage& cube)
+{
+    GLenum format = cube.fourCC == DDS_DXT1 ? GL_COMPRESSED_RGB_S3TC_DXT1_EXT : GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+    int levels = (int)cube.levels.size();
+    unsigned int textureID;
+    glGenTextures(1, &textureID);
+    glBindTexture(GL_TEXTURE_CUBE_MAP, textureID);
+#ifdef GL_ARB_texture_storage
+    if (GLAD_GL_ARB_texture_storage)
+    {
+        glTexStorage2D(GL_TEXTURE_CUBE_MAP, levels, format, cube.width, cube.height);
+        for (int face = 0; face < 6; ++face)
+            for (int level = 0; level < levels; ++level)
+                glCompressedTexSubImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, level, 0, 0, cube.levels[level].width, cube.levels[level].height,
+                                          format, (GLsizei)cube.levels[level].size, cube.levelData(face, level));
+        setCubemapParameters(levels);
+        return textureID;
+    }
+#endif
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAX_LEVEL, levels - 1);
+    for (int face = 0; face < 6; ++face)
+        for (int level = 0; level < levels; ++level)
+            glCompressedTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, level, format, cube.levels[level].width, cube.levels[level].height, 0,
+                                   (GLsizei)cube.levels[level].size, cube.levelData(face, level));
+    setCubemapParameters(levels);
+    return textureID;
+}
+
+// gathers the compiled versions of six face files into one cube; false unless
+// all six exist with the same size and format
+// ------------------------------------------------------------------------
+inline bool readCompiledCubemapFaces(const std::vector<std::string>& paths, DDSImage& cube)
+{
+    for (unsigned int face = 0; face < paths.size(); ++face)
+    {
+        DDSImage image;
+        if (!readCompiledTexture(paths[face], false, image))
+            return false;
+        if (face == 0)
+        {
+            cube = image;
+            cube.faces = 6;
+            continue;
+        }
+        if (image.width != cube.width || image.height != cube.height || image.fourCC != cube.fourCC || image.levels.size() != cube.levels.size())
+            return false;
+        cube.data.insert(cube.data.end(), image.data.begin(), image.data.end());
+    }
+    return paths.size() == 6 && cube.width == cube.height;
+}
+
+// decodes six face files on the pool; false if one is missing or they differ in size
+// -----------------------------------------------------------------------------------
+inline bool decodeCubemapFaces(const std::vector<std::string>& paths, ThreadPool& pool, std::vector<std::vector<unsigned char> >& faces, int& size)
+{
+    std::vector<std::future<DecodedImage> > decoded;
+    for (const std::string& path : paths)
+        decoded.push_back(pool.submit([path]() { return decodeImage(path, 4, false); }));
+    bool ok = true;
+    size = 0;
+    faces.assign(6, std::vector<unsigned char>());
+    for (unsigned int face = 0; face < decoded.size(); ++face)
+    {
+        DecodedImage image = decoded[face].get();
+        if (!image.data || image.width != image.height || (size && image.width != size))
+        {
+            std::cout << "Cubemap texture failed to load at path: " << image.path << std::endl;
+            ok = false;
+        }
+        else
+        {
+            size = image.width;
+            faces[face].assign(image.data, image.data + (size_t)size * size * 4);
+        }
+        freeImage(image);
+    }
+    return ok;
+}
+
+// cuts or projects the six faces out of a single image, one face per job
+// ----------------------------------------------------------------------
+inline bool splitCubemapImage(const std::string& path, ThreadPool& pool, std::vector<std::vector<unsigned char> >& faces, int& size)
+{
+    DecodedImage image = decodeImage(path, 4, false);
+    CubemapLayout layout;
+    if (!image.data || !detectCubemapLayout(image.width, image.height, layout))
+    {
+        std::cout << "Cubemap image is missing or not a 4x3 / 3x4 cross or 2:1 panorama: " << path << std::endl;
+        freeImage(image);
+        return false;
+    }
+    size = cubemapFaceSize(image, layout);
+    std::vector<std::future<std::vector<unsigned char> > > jobs;
+    const DecodedImage* source = &image;
+    for (int face = 0; face < 6; ++face)
+    {
+        if (layout == CUBEMAP_EQUIRECTANGULAR)
+            jobs.push_back(pool.submit([source, face, size]() { return projectEquirectangularFace(*source, face, size); }));
+        else
+            jobs.push_back(pool.submit([source, layout, face, size]() { return extractCrossFace(*source, layout, face, size); }));
+    }
+    faces.clear();
+    for (std::future<std::vector<unsigned char> >& job : jobs)
+        faces.push_back(job.get());
+    freeImage(image);
+    return true;
+}
+
+#endif
@@ -11,6 +11,34 @@
 #include <learnopengl/camera.h>
 #include <learnopengl/model.h>
 
+#include "benchmark.h"
+#include "bounds.h"
+#include "camera_uniforms.h"
+#include "compressed_texture.h"
+#include "cubemap_loader.h"
+#include "file_watcher.h"
+#include "frame_profiler.h"
+#include "headless_context.h"
+#include "image_decode.h"
+#include "input_recorder.h"
+#include "instancing.h"
+#include "material_array.h"
+#include "mesh_lod.h"
+#include "mesh_optimizer.h"
+#include "mesh_registry.h"
+#include "procedural_mesh.h"
+#include "render_queue.h"
+#include "residency_manager.h"
+#include "scene_file.h"
+#include "shader_cache.h"
+#include "static_geometry.h"
+#include "texture_manager.h"
+#include "thread_pool.h"
+#include "vertex_format.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
 #include <iostream>
 
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
@@ -18,7 +46,7 @@ void mouse_callback(GLFWwindow* window, double xpos, double ypos);
 void scroll_callback(GLFWwindow* window, double xoffset, double yoffset);
 void processInput(GLFWwindow *window);
 unsigned int loadTexture(const char *path);
-unsigned int loadCubemap(vector<std::string> faces);
+unsigned int uploadTexture(const DecodedImage& image);
 unsigned int loadCubemap2(vector<std::string> faces);
 
 
@@ -32,506 +60,286 @@ float lastX = (float)SCR_WIDTH / 2.0;
 float lastY = (float)SCR_HEIGHT / 2.0;
 bool firstMouse = true;
 
+// camera input can be recorded to a file and replayed on a fixed timestep
+InputRecorder inputRecorder;
+InputReplay inputReplay;
+
 // timing
 float deltaTime = 0.0f;
 float lastFrame = 0.0f;
-struct Pole {
-    GLfloat x, z, y_start, y_end, u;
-};
 
-std::vector<Pole> generateCylinder(glm::vec3 center, GLfloat height, GLfloat radius, int num_points) {
-    std::vector<Pole> poles;
-    Pole pole;
+// programs are compiled once and shared by source paths
+ShaderCache shaderCache;
 
-    for (int i = 0; i < num_points; ++i) {
-        GLfloat u = i / (GLfloat)num_points;
+// static meshes are uploaded once at startup and drawn by handle every frame;
+// the round ones come in several levels of detail
+MeshRegistry meshRegistry;
+LodChain cylinderLod;
+LodChain domeLod;
+LodChain pillarLod;
+// what the load time mesh optimization did to each procedural mesh
+std::vector<std::pair<std::string, MeshOptimizationReport> > proceduralMeshReports;
 
-        pole.x = center.x + radius * cos(2 * 3.14159265358979323846 * u);
-        pole.z = center.z + radius * sin(2 * 3.14159265358979323846 * u);
-        pole.y_start = 0.0f;
-        pole.y_end = height;
-        pole.u = u;
+// images are decoded on worker threads, only the uploads run on the GL thread
+ThreadPool workers;
 
-        poles.push_back(pole);
-    }
+// textures are decoded once and shared by path
+TextureManager textureManager(loadTexture);
+unsigned int cylinderTexture;
+unsigned int domeTexture;
+unsigned int insideOctagonTexture;
 
-    return poles;
+unsigned int registerProceduralMesh(const ProceduralMesh& mesh, const std::string& name)
+{
+    OptimizedMesh optimized;
+    proceduralMeshReports.push_back(std::make_pair(name, optimizeMesh(&mesh.vertices[0], static_cast<unsigned int>(mesh.vertices.size() / PROCEDURAL_VERTEX_FLOATS),
+                                                                      PROCEDURAL_VERTEX_FLOATS, &mesh.indices[0], mesh.indices.size(), optimized)));
+    return meshRegistry.addIndexed(&optimized.vertices[0], optimized.vertices.size() * sizeof(float), &optimized.indices[0],
+                                   static_cast<unsigned int>(optimized.indices.size()), PROCEDURAL_VERTEX_FLOATS, proceduralMeshLayout());
 }
-unsigned int cylinderVAO = 0;
-unsigned int indexCountc;
 
-void renderCylinder()
+// the dome's cylinder base, open at both ends, from 50 segments down to 8
+// -----------------------------------------------------------------------
+BoundingSphere setupCylinderMesh()
 {
-    if (cylinderVAO == 0)
+    const unsigned int segments[] = { 50, 25, 12, 8 };
+    BoundingSphere bounds;
+    for (unsigned int level : segments)
     {
-        glGenVertexArrays(1, &cylinderVAO);
-
-        unsigned int vbo, ebo;
-        glGenBuffers(1, &vbo);
-        glGenBuffers(1, &ebo);
-
-        std::vector<glm::vec3> positions;
-        std::vector<unsigned int> indices;
-
-        // Generate cylinder vertices
-        glm::vec3 center(0.0f, 0.0f, 0.0f);
-        GLfloat height = 0.1f;
-        GLfloat radius = 0.35f;
-        int num_points = 50;
-        std::vector<Pole> cylinderVertices = generateCylinder(center, height, radius, num_points);
-
-        // Convert cylinder vertices to positions array
-        for (const auto& pole : cylinderVertices)
-        {
-            positions.push_back(glm::vec3(pole.x, pole.y_start, pole.z));
-            positions.push_back(glm::vec3(pole.x, pole.y_end, pole.z));
-        }
-
-        // Generate cylinder indices
-        for (unsigned int i = 0; i < cylinderVertices.size() * 2; ++i)
-        {
-            indices.push_back(i);
-        }
-
-        indexCountc = static_cast<unsigned int>(indices.size());
-        glBindVertexArray(cylinderVAO);
-        glBindBuffer(GL_ARRAY_BUFFER, vbo);
-        glBufferData(GL_ARRAY_BUFFER, positions.size() * sizeof(glm::vec3), &positions[0], GL_STATIC_DRAW);
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
-        unsigned int stride = 3 * sizeof(float);
-        glEnableVertexAttribArray(0);
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, (void*)0);
-        glEnableVertexAttribArray(1); // Enable texture coordinate attribute
-        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, stride, (void*)(3 * sizeof(float)));
-
+        ProceduralMesh cylinder = generateCylinder(0.35f, 0.1f, level, false);
+        cylinderLod.addLevel(registerProceduralMesh(cylinder, "cylinder/" + std::to_string(level)), (unsigned int)cylinder.indices.size() / 3, lodMaxPixels(level));
+        if (level == segments[0])
+            bounds = boundingSphere(cylinder);
     }
-    unsigned int cdTexture;
-    glGenTextures(1, &cdTexture);
-    glBindTexture(GL_TEXTURE_2D, cdTexture);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    int width1, height1, nrChannels1;
-    stbi_set_flip_vertically_on_load(true);
-    unsigned char* data1 = stbi_load(FileSystem::getPath("resources/textures/mosaic.jpg").c_str(), &width1, &height1, &nrChannels1, 0);
-    if (data1)
+    return bounds;
+}
+
+// the golden dome on top of it, a unit hemisphere from 64 segments down to 8
+// --------------------------------------------------------------------------
+BoundingSphere setupSphereMesh()
+{
+    const unsigned int segments[] = { 64, 32, 16, 8 };
+    BoundingSphere bounds;
+    for (unsigned int level : segments)
     {
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width1, height1, 0, GL_RGB, GL_UNSIGNED_BYTE, data1);
+        ProceduralMesh dome = generateDome(1.0f, level, level / 2);
+        domeLod.addLevel(registerProceduralMesh(dome, "dome/" + std::to_string(level)), (unsigned int)dome.indices.size() / 3, lodMaxPixels(level));
+        if (level == segments[0])
+            bounds = boundingSphere(dome);
     }
-    else
+    return bounds;
+}
+
+// one pillar of the colonnade, a thin capped cylinder from 16 segments down to 6
+// -------------------------------------------------------------------------------
+BoundingSphere setupPillarMesh()
+{
+    const unsigned int segments[] = { 16, 8, 6 };
+    BoundingSphere bounds;
+    for (unsigned int level : segments)
     {
-        std::cout << "Failed to load texture" << std::endl;
+        ProceduralMesh pillar = generateCylinder(0.03f, 0.6f, level, true);
+        pillarLod.addLevel(registerProceduralMesh(pillar, "pillar/" + std::to_string(level)), (unsigned int)pillar.indices.size() / 3, lodMaxPixels(level));
+        if (level == segments[0])
+            bounds = boundingSphere(pillar);
     }
-    stbi_image_free(data1);
-
-    glBindVertexArray(cylinderVAO);
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, cdTexture);
-    glDrawElements(GL_TRIANGLE_STRIP, indexCountc, GL_UNSIGNED_INT, 0);
+    return bounds;
 }
-unsigned int sphereVAO = 0;
-unsigned int indexCount;
-void renderSphere()
+
+// the colonnade around the octagon: where each pillar stands on the yard and
+// the material layer it samples when the walls come from the texture array
+// ---------------------------------------------------------------------------
+std::vector<InstanceData> colonnadeInstances(unsigned int pillars, float radius, const unsigned int materials[2])
 {
-    if (sphereVAO == 0)
+    std::vector<InstanceData> instances;
+    for (unsigned int i = 0; i < pillars; ++i)
     {
-        glGenVertexArrays(1, &sphereVAO);
+        float angle = 2.0f * 3.14159265358979f * (i + 0.5f) / pillars;
+        InstanceData instance;
+        instance.model = glm::translate(glm::mat4(1.0f), glm::vec3(radius * std::cos(angle), -0.8f, radius * std::sin(angle)));
+        instance.material = (float)materials[i % 2];
+        instances.push_back(instance);
+    }
+    return instances;
+}
 
-        unsigned int vbo, ebo;
-        glGenBuffers(1, &vbo);
-        glGenBuffers(1, &ebo);
+// the octagon's floor plan in the xz plane; the outer shell is a capped prism
+// over it and the inner walls an open one
+// ---------------------------------------------------------------------------
+const std::vector<glm::vec2> octagonOutline = {
+    glm::vec2(0.0f, -1.0f), glm::vec2(0.75f, -0.75f), glm::vec2(1.0f, 0.0f), glm::vec2(0.75f, 0.75f),
+    glm::vec2(0.0f, 1.0f), glm::vec2(-0.75f, 0.75f), glm::vec2(-1.0f, 0.0f), glm::vec2(-0.75f, -0.75f)
+};
+
+// the objects of the static environment, in the order of its draw ranges;
+// the names are how they are stored in a scene file
+enum SceneObject {
+    OBJECT_BASE,
+    OBJECT_LEFT_ROAD,
+    OBJECT_RIGHT_ROAD,
+    OBJECT_GRASS,
+    OBJECT_YARD,
+    OBJECT_BACK_WALL,
+    OBJECT_FRONT_WALL,
+    OBJECT_LEFT_WALL,
+    OBJECT_RIGHT_WALL,
+    OBJECT_BACK_WALL_YARD,
+    OBJECT_FRONT_WALL_YARD,
+    OBJECT_LEFT_WALL_YARD,
+    OBJECT_RIGHT_WALL_YARD,
+    OBJECT_GATE,
+    OBJECT_BOX,
+    OBJECT_OCTAGON,
+    OBJECT_INSIDE_OCTAGON,
+    OBJECT_COUNT
+};
+const char* sceneObjectNames[OBJECT_COUNT] = {
+    "base", "leftRoad", "rightRoad", "grass", "yard",
+    "backWall", "frontWall", "leftWall", "rightWall",
+    "backWallYard", "frontWallYard", "leftWallYard", "rightWallYard",
+    "gate", "box", "octagon", "insideOctagon"
+};
 
-        std::vector<glm::vec3> positions;
-        std::vector<glm::vec2> uv;
-        std::vector<glm::vec3> normals;
-        std::vector<unsigned int> indices;
 
-        const unsigned int X_SEGMENTS = 64;
-        const unsigned int Y_SEGMENTS = 64;
-        const float PI = 3.14159265359f;
-        for (unsigned int x = 0; x <= X_SEGMENTS; ++x)
-        {
-            for (unsigned int y = 0; y <= Y_SEGMENTS; ++y)
-            {
-                float xSegment = (float)x / (float)X_SEGMENTS;
-                float ySegment = (float)y / (float)Y_SEGMENTS;
-                float xPos = std::cos(xSegment * 2.0f * PI) * std::sin(ySegment * PI);
-                float yPos = std::cos(ySegment * PI);
-                float zPos = std::sin(xSegment * 2.0f * PI) * std::sin(ySegment * PI);
-                if (yPos >= 0.0) {
-                    positions.push_back(glm::vec3(xPos, yPos, zPos));
-                    uv.push_back(glm::vec2(xSegment, ySegment));
-                    normals.push_back(glm::vec3(xPos, yPos, zPos));
-                }
-            }
-        }
 
-        bool oddRow = false;
-        for (unsigned int y = 0; y < Y_SEGMENTS; ++y)
+int main(int argc, char* argv[])
+{
+    // command line options
+    // --------------------
+    bool useTextureArray = false; // --texture-array: ground and walls sample one GL_TEXTURE_2D_ARRAY
+    bool profile = false;         // --profile: per-stage CPU/GPU timings
+    const char* profileCsv = NULL;  // --profile-csv <file>: also dump every frame as CSV
+    int benchFrames = 0;            // --bench <frames>: render offscreen along a fixed path, no window
+    const char* recordPath = NULL;  // --record <file>: write the camera input to a file
+    const char* replayPath = NULL;  // --replay <file>: drive the camera from a recording instead
+    const char* skyboxPath = NULL;  // --skybox <file>: one cross / panorama image or a cube .dds instead of six faces
+    const char* scenePath = NULL;   // --scene <file>: load the environment geometry from a scene file
+    const char* exportScenePath = NULL; // --export-scene <file>: write the built-in environment to a scene file
+    int textureBudget = 0;          // --texture-budget <MB>: reduce far or hidden textures to stay below this
+    bool programCache = true;       // --no-program-cache: always compile the shaders from source
+    bool premultiply = false;       // --premultiply-alpha: store color multiplied by alpha in decoded textures
+    bool quantize = false;          // --quantize-vertices: store mesh vertices as 16-bit components
+    const char* bundlePath = NULL;  // --bundle <file>: read textures and shaders from an asset_packer bundle
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg == "--texture-array")
+            useTextureArray = true;
+        else if (arg == "--profile")
+            profile = true;
+        else if (arg == "--profile-csv" && i + 1 < argc)
         {
-            if (!oddRow) // even rows: y == 0, y == 2; and so on
-            {
-                for (unsigned int x = 0; x <= X_SEGMENTS; ++x)
-                {
-                    indices.push_back(y * (X_SEGMENTS + 1) + x);
-                    indices.push_back((y + 1) * (X_SEGMENTS + 1) + x);
-                }
-            }
-            else
-            {
-                for (int x = X_SEGMENTS; x >= 0; --x)
-                {
-                    indices.push_back((y + 1) * (X_SEGMENTS + 1) + x);
-                    indices.push_back(y * (X_SEGMENTS + 1) + x);
-                }
-            }
-            oddRow = !oddRow;
+            profile = true;
+            profileCsv = argv[++i];
         }
-        indexCount = static_cast<unsigned int>(indices.size());
-
-        std::vector<float> data;
-        for (unsigned int i = 0; i < positions.size(); ++i)
+        else if (arg == "--bench" && i + 1 < argc)
+            benchFrames = std::atoi(argv[++i]);
+        else if (arg == "--record" && i + 1 < argc)
+            recordPath = argv[++i];
+        else if (arg == "--replay" && i + 1 < argc)
+            replayPath = argv[++i];
+        else if (arg == "--skybox" && i + 1 < argc)
+            skyboxPath = argv[++i];
+        else if (arg == "--scene" && i + 1 < argc)
+            scenePath = argv[++i];
+        else if (arg == "--export-scene" && i + 1 < argc)
+            exportScenePath = argv[++i];
+        else if (arg == "--texture-budget" && i + 1 < argc)
         {
-            data.push_back(positions[i].x);
-            data.push_back(positions[i].y);
-            data.push_back(positions[i].z);
-            if (normals.size() > 0)
-            {
-                data.push_back(normals[i].x);
-                data.push_back(normals[i].y);
-                data.push_back(normals[i].z);
-            }
-            if (uv.size() > 0)
+            // whole megabytes only; anything else would turn into a budget of
+            // zero (no budget) or a huge one once it is scaled to bytes
+            char* end = NULL;
+            long budget = std::strtol(argv[++i], &end, 10);
+            if (end == argv[i] || *end != '\0' || budget <= 0 || budget > 1024 * 1024)
             {
-                data.push_back(uv[i].x);
-                data.push_back(uv[i].y);
+                std::cout << "--texture-budget needs a whole number of megabytes from 1 to 1048576, got: " << argv[i] << std::endl;
+                return -1;
             }
+            textureBudget = (int)budget;
         }
-        glBindVertexArray(sphereVAO);
-        glBindBuffer(GL_ARRAY_BUFFER, vbo);
-        glBufferData(GL_ARRAY_BUFFER, data.size() * sizeof(float), &data[0], GL_STATIC_DRAW);
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
-        unsigned int stride = (3 + 2 + 3) * sizeof(float);
-        glEnableVertexAttribArray(0);
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, (void*)0);
-        glEnableVertexAttribArray(1);
-        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, stride, (void*)(3 * sizeof(float)));
-        glEnableVertexAttribArray(2);
-        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, stride, (void*)(6 * sizeof(float)));
+        else if (arg == "--no-program-cache")
+            programCache = false;
+        else if (arg == "--premultiply-alpha")
+            premultiply = true;
+        else if (arg == "--quantize-vertices")
+            quantize = true;
+        else if (arg == "--bundle" && i + 1 < argc)
+            bundlePath = argv[++i];
     }
+    bool bench = benchFrames > 0;
+    premultiplyAlphaOnLoad() = premultiply;
+    quantizeVerticesOnLoad() = quantize;
 
-    glBindVertexArray(sphereVAO);
-    glDrawElements(GL_TRIANGLE_STRIP, indexCount, GL_UNSIGNED_INT, 0);
-}
-void renderInsideOctagon(glm::mat4 view, glm::mat4 projection, glm::mat4 model) {
-    float inside[]{
-        // 1
-     0.0f, 1.0f, -1.0f, 0.0f, 1.0f,
-     0.0f, 0.0f, -1.0f, 0.0f, 0.0f,
-     0.75f, 1.0f, -0.75f, 1.0f, 1.0f,
-     0.0f, 0.0f, -1.0f, 0.0f, 0.0f,
-     0.75f, 1.0f, -0.75f, 1.0f, 1.0f,
-     0.75f, 0.0f, -0.75f, 1.0f, 0.0f,
-
-     // 2
-     0.75f, 1.0f, -0.75f, 0.0f, 1.0f,
-     0.75f, 0.0f, -0.75f, 0.0f, 0.0f,
-     1.0f, 1.0f, 0.0f, 1.0f, 1.0f,
-     0.75f, 0.0f, -0.75f, 0.0f, 0.0f,
-     1.0f, 1.0f, 0.0f, 1.0f, 1.0f,
-     1.0f, 0.0f, 0.0f, 1.0f, 0.0f,
-
-     // 3
-     1.0f, 1.0f, 0.0f, 0.0f, 1.0f,
-     1.0f, 0.0f, 0.0f, 0.0f, 0.0f,
-     0.75f, 1.0f, 0.75f, 1.0f, 1.0f,
-     1.0f, 0.0f, 0.0f, 0.0f, 0.0f,
-     0.75f, 1.0f, 0.75f, 1.0f, 1.0f,
-     0.75f, 0.0f, 0.75f, 1.0f, 0.0f,
-
-     // 4
-     0.75f, 1.0f, 0.75f, 0.0f, 1.0f,
-     0.75f, 0.0f, 0.75f, 0.0f, 0.0f,
-     0.0f, 1.0f, 1.0f, 1.0f, 1.0f,
-     0.75f, 0.0f, 0.75f, 0.0f, 0.0f,
-     0.0f, 1.0f, 1.0f, 1.0f, 1.0f,
-     0.0f, 0.0f, 1.0f, 1.0f, 0.0f,
-
-     // 5
-     0.0f, 1.0f, 1.0f, 0.0f, 1.0f,
-     0.0f, 0.0f, 1.0f, 0.0f, 0.0f,
-     -0.75f, 1.0f, 0.75f, 1.0f, 1.0f,
-     0.0f, 0.0f, 1.0f, 0.0f, 0.0f,
-     -0.75f, 1.0f, 0.75f, 1.0f, 1.0f,
-     -0.75f, 0.0f, 0.75f, 1.0f, 0.0f,
-
-     // 6
-     -0.75f, 1.0f, 0.75f, 0.0f, 1.0f,
-     -0.75f, 0.0f, 0.75f, 0.0f, 0.0f,
-     -1.0f, 1.0f, 0.0f, 1.0f, 1.0f,
-     -0.75f, 0.0f, 0.75f, 0.0f, 0.0f,
-     -1.0f, 1.0f, 0.0f, 1.0f, 1.0f,
-     -1.0f, 0.0f, 0.0f, 1.0f, 0.0f,
-
-     // 7
-     -1.0f, 1.0f, 0.0f, 0.0f, 1.0f,
-     -1.0f, 0.0f, 0.0f, 0.0f, 0.0f,
-     -0.75f, 1.0f, -0.75f, 1.0f, 1.0f,
-     -1.0f, 0.0f, 0.0f, 0.0f, 0.0f,
-     -0.75f, 1.0f, -0.75f, 1.0f, 1.0f,
-     -0.75f, 0.0f, -0.75f, 1.0f, 0.0f,
-
-     // 8
-     -0.75f, 1.0f, -0.75f, 0.0f, 1.0f,
-     -0.75f, 0.0f, -0.75f, 0.0f, 0.0f,
-     0.0f, 1.0f, -1.0f, 1.0f, 1.0f,
-     -0.75f, 0.0f, -0.75f, 0.0f, 0.0f,
-     0.0f, 1.0f, -1.0f, 1.0f, 1.0f,
-     0.0f, 0.0f, -1.0f, 1.0f, 0.0f,
-    };
-
-    Shader rockShader("1.1.depth_testing.vs", "1.1.depth_testing.fs");
-
-    rockShader.use();
-    rockShader.setInt("texture1", 0); // First texture
-  
-    unsigned int inVBO, inVAO;
-    glGenVertexArrays(1, &inVAO);
-    glGenBuffers(1, &inVBO);
-    glBindVertexArray(inVAO);
-    glBindBuffer(GL_ARRAY_BUFFER, inVBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(inside), inside, GL_STATIC_DRAW);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)(3 * sizeof(float)));
-    glEnableVertexAttribArray(1);
-    unsigned int domeTexture2 = loadTexture(FileSystem::getPath("resources/textures/in.jpg").c_str());
-
-    rockShader.use();
-    unsigned int modelLoc = glGetUniformLocation(rockShader.ID, "model");
-    unsigned int viewLoc = glGetUniformLocation(rockShader.ID, "view");
-    glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-    glUniformMatrix4fv(viewLoc, 1, GL_FALSE, glm::value_ptr(view));
-    rockShader.setMat4("projection", projection);
-    glBindVertexArray(inVAO);
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, domeTexture2);
-    glDrawArrays(GL_TRIANGLES, 0, 48);
-
-    glDeleteVertexArrays(1, &inVAO);
-    glDeleteBuffers(1, &inVBO);
-}
-
-void renderOctagon(glm::mat4 view, glm::mat4 projection, glm::mat4 model) {
-   
-    float vertices[] = {
-        // bottom
-        0.0f, 0.0f, 1.0f, 0.0f, 0.0f,
-        -0.75f, 0.0f, 0.75f, 0.0f, 0.1f,
-        0.0f, 0.0f, 0.0f, 1.0f, 0.0f,
-        -0.75f, 0.0f, 0.75f, 0.0f, 1.0f,
-        -1.0f, 0.0f, 0.0f, 1.0f, 0.0f,
-        0.0f, 0.0f, 0.0f, 1.0f, 1.0f,
-        -1.0f, 0.0f, 0.0f, 0.0f, 0.0f,
-        -0.75f, 0.0f, -0.75f, 0.0f, 0.1f,
-        0.0f, 0.0f, 0.0f, 1.0f, 0.0f,
-        -0.75f, 0.0f, -0.75f, 0.0f, 1.0f,
-        0.0f, 0.0f, -1.0f, 1.0f, 0.0f,
-        0.0f, 0.0f, 0.0f, 1.0f, 1.0f,
-        0.0f, 0.0f, -1.0f, 0.0f, 0.0f,
-        0.75f, 0.0f, -0.75f, 0.0f, 0.1f,
-        0.0f, 0.0f, 0.0f, 1.0f, 0.0f,
-        0.75f, 0.0f, -0.75f, 0.0f, 1.0f,
-        1.0f, 0.0f, 0.0f, 1.0f, 0.0f,
-        0.0f, 0.0f, 0.0f, 1.0f, 1.0f,
-        1.0f, 0.0f, 0.0f, 0.0f, 0.0f,
-        0.75f, 0.0f, 0.75f, 0.0f, 0.1f,
-        0.0f, 0.0f, 0.0f, 1.0f, 0.0f,
-        0.75f, 0.0f, 0.75f, 0.0f, 1.0f,
-        0.0f, 0.0f, 1.0f, 1.0f, 0.0f,
-        0.0f, 0.0f, 0.0f, 1.0f, 1.0f,
-
-        // top
-        0.0f, 1.0f, 1.0f, 0.0f, 0.0f,
-        -0.75f, 1.0f, 0.75f, 0.0f, 0.1f,
-        0.0f, 1.0f, 0.0f, 1.0f, 0.0f,
-        -0.75f, 1.0f, 0.75f, 0.0f, 1.0f,
-        -1.0f, 1.0f, 0.0f, 1.0f, 0.0f,
-        0.0f, 1.0f, 0.0f, 1.0f, 1.0f,
-        -1.0f, 1.0f, 0.0f, 0.0f, 0.0f,
-        -0.75f, 1.0f, -0.75f, 0.0f, 0.1f,
-        0.0f, 1.0f, 0.0f, 1.0f, 0.0f,
-        -0.75f, 1.0f, -0.75f, 0.0f, 1.0f,
-        0.0f, 1.0f, -1.0f, 1.0f, 0.0f,
-        0.0f, 1.0f, 0.0f, 1.0f, 1.0f,
-        0.0f, 1.0f, -1.0f, 0.0f, 0.0f,
-        0.75f, 1.0f, -0.75f, 0.0f, 0.1f,
-        0.0f, 1.0f, 0.0f, 1.0f, 0.0f,
-        0.75f, 1.0f, -0.75f, 0.0f, 1.0f,
-        1.0f, 1.0f, 0.0f, 1.0f, 0.0f,
-        0.0f, 1.0f, 0.0f, 1.0f, 1.0f,
-        1.0f, 1.0f, 0.0f, 0.0f, 0.0f,
-        0.75f, 1.0f, 0.75f, 0.0f, 0.1f,
-        0.0f, 1.0f, 0.0f, 1.0f, 0.0f,
-        0.75f, 1.0f, 0.75f, 0.0f, 1.0f,
-        0.0f, 1.0f, 1.0f, 1.0f, 0.0f,
-        0.0f, 1.0f, 0.0f, 1.0f, 1.0f,
-
-        // 1
-        0.0f, 1.0f, -1.0f, 0.0f, 1.0f,
-        0.0f, 0.0f, -1.0f, 0.0f, 0.0f,
-        0.75f, 1.0f, -0.75f, 1.0f, 1.0f,
-        0.0f, 0.0f, -1.0f, 0.0f, 0.0f,
-        0.75f, 1.0f, -0.75f, 1.0f, 1.0f,
-        0.75f, 0.0f, -0.75f, 1.0f, 0.0f,
-
-        // 2
-        0.75f, 1.0f, -0.75f, 0.0f, 1.0f,
-        0.75f, 0.0f, -0.75f, 0.0f, 0.0f,
-        1.0f, 1.0f, 0.0f, 1.0f, 1.0f,
-        0.75f, 0.0f, -0.75f, 0.0f, 0.0f,
-        1.0f, 1.0f, 0.0f, 1.0f, 1.0f,
-        1.0f, 0.0f, 0.0f, 1.0f, 0.0f,
-
-        // 3
-        1.0f, 1.0f, 0.0f, 0.0f, 1.0f,
-        1.0f, 0.0f, 0.0f, 0.0f, 0.0f,
-        0.75f, 1.0f, 0.75f, 1.0f, 1.0f,
-        1.0f, 0.0f, 0.0f, 0.0f, 0.0f,
-        0.75f, 1.0f, 0.75f, 1.0f, 1.0f,
-        0.75f, 0.0f, 0.75f, 1.0f, 0.0f,
-
-        // 4
-        0.75f, 1.0f, 0.75f, 0.0f, 1.0f,
-        0.75f, 0.0f, 0.75f, 0.0f, 0.0f,
-        0.0f, 1.0f, 1.0f, 1.0f, 1.0f,
-        0.75f, 0.0f, 0.75f, 0.0f, 0.0f,
-        0.0f, 1.0f, 1.0f, 1.0f, 1.0f,
-        0.0f, 0.0f, 1.0f, 1.0f, 0.0f,
-
-        // 5
-        0.0f, 1.0f, 1.0f, 0.0f, 1.0f,
-        0.0f, 0.0f, 1.0f, 0.0f, 0.0f,
-        -0.75f, 1.0f, 0.75f, 1.0f, 1.0f,
-        0.0f, 0.0f, 1.0f, 0.0f, 0.0f,
-        -0.75f, 1.0f, 0.75f, 1.0f, 1.0f,
-        -0.75f, 0.0f, 0.75f, 1.0f, 0.0f,
-
-        // 6
-        -0.75f, 1.0f, 0.75f, 0.0f, 1.0f,
-        -0.75f, 0.0f, 0.75f, 0.0f, 0.0f,
-        -1.0f, 1.0f, 0.0f, 1.0f, 1.0f,
-        -0.75f, 0.0f, 0.75f, 0.0f, 0.0f,
-        -1.0f, 1.0f, 0.0f, 1.0f, 1.0f,
-        -1.0f, 0.0f, 0.0f, 1.0f, 0.0f,
-
-        // 7
-        -1.0f, 1.0f, 0.0f, 0.0f, 1.0f,
-        -1.0f, 0.0f, 0.0f, 0.0f, 0.0f,
-        -0.75f, 1.0f, -0.75f, 1.0f, 1.0f,
-        -1.0f, 0.0f, 0.0f, 0.0f, 0.0f,
-        -0.75f, 1.0f, -0.75f, 1.0f, 1.0f,
-        -0.75f, 0.0f, -0.75f, 1.0f, 0.0f,
-
-        // 8
-        -0.75f, 1.0f, -0.75f, 0.0f, 1.0f,
-        -0.75f, 0.0f, -0.75f, 0.0f, 0.0f,
-        0.0f, 1.0f, -1.0f, 1.0f, 1.0f,
-        -0.75f, 0.0f, -0.75f, 0.0f, 0.0f,
-        0.0f, 1.0f, -1.0f, 1.0f, 1.0f,
-        0.0f, 0.0f, -1.0f, 1.0f, 0.0f,
-
-
-    };
-   
-
-    Shader rockShader("1.1.depth_testing.vs", "1.1.depth_testing.fs");
-
-    rockShader.use();
-    rockShader.setInt("texture1", 0); // First texture
-    rockShader.setInt("texture2", 1); // Second texture
-
-
-    unsigned int VBO, VAO;
-    glGenVertexArrays(1, &VAO);
-    glGenBuffers(1, &VBO);
-    glBindVertexArray(VAO);
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)(3 * sizeof(float)));
-    glEnableVertexAttribArray(1);
-
-    unsigned int domeTexture = loadTexture(FileSystem::getPath("resources/textures/dome1.png").c_str());
-    rockShader.use();
-    unsigned int modelLoc = glGetUniformLocation(rockShader.ID, "model");
-    unsigned int viewLoc = glGetUniformLocation(rockShader.ID, "view");
-    glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-    glUniformMatrix4fv(viewLoc, 1, GL_FALSE, glm::value_ptr(view));
-    rockShader.setMat4("projection", projection);
-    glBindVertexArray(VAO);
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, domeTexture);
-    glDrawArrays(GL_TRIANGLES, 0, 96);
-    glDeleteVertexArrays(1, &VAO);
-    glDeleteBuffers(1, &VBO);
-
-
-}
-
-
+    // every loader looks in the bundle first and falls back to the files
+    AssetBundle assetBundle;
+    if (bundlePath && assetBundle.open(bundlePath, FileSystem::getPath("")))
+    {
+        mountedAssetBundle() = &assetBundle;
+        std::cout << "Reading " << assetBundle.size() << " assets from " << bundlePath << std::endl;
+    }
 
-int main()
-{
-    // glfw: initialize and configure
-    // ------------------------------
-    glfwInit();
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    // benchmark mode renders into a framebuffer of a headless context instead
+    // ------------------------------------------------------------------------
+    GLFWwindow* window = NULL;
+    HeadlessContext headless;
+    if (bench)
+    {
+        if (!headless.create())
+            return -1;
+    }
+    else
+    {
+        // glfw: initialize and configure
+        // ------------------------------
+        glfwInit();
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+        glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
 
 #ifdef __APPLE__
-    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+        glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
 #endif
 
-    // glfw window creation
-    // --------------------
-    GLFWwindow* window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "LearnOpenGL", NULL, NULL);
-    if (window == NULL)
-    {
-        std::cout << "Failed to create GLFW window" << std::endl;
-        glfwTerminate();
-        return -1;
-    }
-    glfwMakeContextCurrent(window);
-    glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
-    glfwSetCursorPosCallback(window, mouse_callback);
-    glfwSetScrollCallback(window, scroll_callback);
+        // glfw window creation
+        // --------------------
+        window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "LearnOpenGL", NULL, NULL);
+        if (window == NULL)
+        {
+            std::cout << "Failed to create GLFW window" << std::endl;
+            glfwTerminate();
+            return -1;
+        }
+        glfwMakeContextCurrent(window);
+        glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
+        glfwSetCursorPosCallback(window, mouse_callback);
+        glfwSetScrollCallback(window, scroll_callback);
 
-    // tell GLFW to capture our mouse
-    glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+        // tell GLFW to capture our mouse
+        glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
 
-    // glad: load all OpenGL function pointers
-    // ---------------------------------------
-    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
-    {
-        std::cout << "Failed to initialize GLAD" << std::endl;
-        return -1;
+        // glad: load all OpenGL function pointers
+        // ---------------------------------------
+        if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
+        {
+            std::cout << "Failed to initialize GLAD" << std::endl;
+            return -1;
+        }
     }
 
     // configure global opengl state
     // -----------------------------
     glEnable(GL_DEPTH_TEST);
-
-    // build and compile shaders
-    // -------------------------
-    Shader shader("6.2.cubemaps.vs", "6.2.cubemaps.fs");
-    Shader skyboxShader("6.2.skybox.vs", "6.2.skybox.fs");
-    Shader ourShader("1.1.depth_testing.vs", "1.1.depth_testing.fs");
+    // filter across cube face edges, otherwise minified reflections show the seams
+    glEnable(GL_TEXTURE_CUBE_MAP_SEAMLESS);
+
+    // build and compile shaders; warm starts load the linked programs from disk
+    // -------------------------------------------------------------------------
+    if (programCache)
+        shaderCache.setBinaryCache("program_cache");
+    // quantized meshes carry octahedral normals, which need their own decode
+    ShaderProgram& shader = shaderCache.get(quantize ? "6.2.cubemaps_quantized.vs" : "6.2.cubemaps.vs", "6.2.cubemaps.fs");
+    ShaderProgram& skyboxShader = shaderCache.get("6.2.skybox.vs", "6.2.skybox.fs");
+    ShaderProgram& ourShader = shaderCache.get("1.1.depth_testing.vs", "1.1.depth_testing.fs");
   //  Shader rockShader("C:\\Users\\Jeda\\Desktop\\LearnOpenGLTry\\src\\1.getting_started\\6.2.coordinate_systems_depth\\6.2.coordinate_systems.vs", "C:\\Users\\Jeda\\Desktop\\LearnOpenGLTry\\src\\1.getting_started\\6.2.coordinate_systems_depth\\6.2.coordinate_systems.fs");
 
     // set up vertex data (and buffer(s)) and configure vertex attributes
@@ -888,8 +696,8 @@ int main()
     glBufferData(GL_ARRAY_BUFFER, sizeof(cubeVertices), &cubeVertices, GL_STATIC_DRAW);
     glEnableVertexAttribArray(0);
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)(3 * sizeof(float)));
+    glEnableVertexAttribArray(2);
+    glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)(3 * sizeof(float)));
     // skybox VAO
     unsigned int skyboxVAO, skyboxVBO;
     glGenVertexArrays(1, &skyboxVAO);
@@ -907,160 +715,68 @@ int main()
     glBufferData(GL_ARRAY_BUFFER, sizeof(boxVertices), &boxVertices, GL_STATIC_DRAW);
     glEnableVertexAttribArray(0);
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)0);*/
-    unsigned int VAO, VBO;
-    glGenVertexArrays(1, &VAO);
-    glGenBuffers(1, &VBO);
-    glBindVertexArray(VAO);
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(base), &base, GL_STATIC_DRAW);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)(3 * sizeof(float)));
-    glBindVertexArray(0);
-    unsigned int grassVAO, grassVBO;
-    glGenVertexArrays(1, &grassVAO);
-    glGenBuffers(1, &grassVBO);
-    glBindVertexArray(grassVAO);
-    glBindBuffer(GL_ARRAY_BUFFER, grassVBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(grass), &grass, GL_STATIC_DRAW);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)(3 * sizeof(float)));
-    glBindVertexArray(0);
-    unsigned int yardVAO, yardVBO;
-    glGenVertexArrays(1, &yardVAO);
-    glGenBuffers(1, &yardVBO);
-    glBindVertexArray(yardVAO);
-    glBindBuffer(GL_ARRAY_BUFFER, yardVBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(yard), &yard, GL_STATIC_DRAW);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)(3 * sizeof(float)));
-    glBindVertexArray(0);
-    unsigned int backWallVAO, backWallVBO;
-    glGenVertexArrays(1, &backWallVAO);
-    glGenBuffers(1, &backWallVBO);
-    glBindVertexArray(backWallVAO);
-    glBindBuffer(GL_ARRAY_BUFFER, backWallVBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(backWall), &backWall, GL_STATIC_DRAW);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)(3 * sizeof(float)));
-    glBindVertexArray(0);
-    unsigned int frontWallVAO, frontWallVBO;
-    glGenVertexArrays(1, &frontWallVAO);
-    glGenBuffers(1, &frontWallVBO);
-    glBindVertexArray(frontWallVAO);
-    glBindBuffer(GL_ARRAY_BUFFER, frontWallVBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(frontWall), &frontWall, GL_STATIC_DRAW);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)(3 * sizeof(float)));
-    glBindVertexArray(0);
-    unsigned int leftWallVAO, leftWallVBO;
-    glGenVertexArrays(1, &leftWallVAO);
-    glGenBuffers(1, &leftWallVBO);
-    glBindVertexArray(leftWallVAO);
-    glBindBuffer(GL_ARRAY_BUFFER, leftWallVBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(leftWall), &leftWall, GL_STATIC_DRAW);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)(3 * sizeof(float)));
-    glBindVertexArray(0);
-    unsigned int rightWallVAO, rightWallVBO;
-    glGenVertexArrays(1, &rightWallVAO);
-    glGenBuffers(1, &rightWallVBO);
-    glBindVertexArray(rightWallVAO);
-    glBindBuffer(GL_ARRAY_BUFFER, rightWallVBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(rightWall), &rightWall, GL_STATIC_DRAW);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)(3 * sizeof(float)));
-    glBindVertexArray(0);
-    unsigned int backWallYardVAO, backWallYardVBO;
-    glGenVertexArrays(1, &backWallYardVAO);
-    glGenBuffers(1, &backWallYardVBO);
-    glBindVertexArray(backWallYardVAO);
-    glBindBuffer(GL_ARRAY_BUFFER, backWallYardVBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(backWallYard), &backWallYard, GL_STATIC_DRAW);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)(3 * sizeof(float)));
-    glBindVertexArray(0);
-    unsigned int frontWallYardVAO, frontWallYardVBO;
-    glGenVertexArrays(1, &frontWallYardVAO);
-    glGenBuffers(1, &frontWallYardVBO);
-    glBindVertexArray(frontWallYardVAO);
-    glBindBuffer(GL_ARRAY_BUFFER, frontWallYardVBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(frontWallYard), &frontWallYard, GL_STATIC_DRAW);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)(3 * sizeof(float)));
-    glBindVertexArray(0);
-    unsigned int leftWallYardVAO, leftWallYardVBO;
-    glGenVertexArrays(1, &leftWallYardVAO);
-    glGenBuffers(1, &leftWallYardVBO);
-    glBindVertexArray(leftWallYardVAO);
-    glBindBuffer(GL_ARRAY_BUFFER, leftWallYardVBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(leftWallYard), &leftWallYard, GL_STATIC_DRAW);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)(3 * sizeof(float)));
-    glBindVertexArray(0);
-    unsigned int rightWallYardVAO, rightWallYardVBO;
-    glGenVertexArrays(1, &rightWallYardVAO);
-    glGenBuffers(1, &rightWallYardVBO);
-    glBindVertexArray(rightWallYardVAO);
-    glBindBuffer(GL_ARRAY_BUFFER, rightWallYardVBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(rightWallYard), &rightWallYard, GL_STATIC_DRAW);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)(3 * sizeof(float)));
-    glBindVertexArray(0);
-    unsigned int gateVAO, gateVBO;
-    glGenVertexArrays(1, &gateVAO);
-    glGenBuffers(1, &gateVBO);
-    glBindVertexArray(gateVAO);
-    glBindBuffer(GL_ARRAY_BUFFER, gateVBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(gate), &gate, GL_STATIC_DRAW);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)(3 * sizeof(float)));
-    glBindVertexArray(0);
-    unsigned int leftRoadVAO, leftRoadVBO;
-    glGenVertexArrays(1, &leftRoadVAO);
-    glGenBuffers(1, &leftRoadVBO);
-    glBindVertexArray(leftRoadVAO);
-    glBindBuffer(GL_ARRAY_BUFFER, leftRoadVBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(leftRoad), &leftRoad, GL_STATIC_DRAW);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)(3 * sizeof(float)));
-    glBindVertexArray(0);
-    unsigned int rightRoadVAO, rightRoadVBO;
-    glGenVertexArrays(1, &rightRoadVAO);
-    glGenBuffers(1, &rightRoadVBO);
-    glBindVertexArray(rightRoadVAO);
-    glBindBuffer(GL_ARRAY_BUFFER, rightRoadVBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(rightRoad), &rightRoad, GL_STATIC_DRAW);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)(3 * sizeof(float)));
-    glBindVertexArray(0);
+    // pack the static environment into one vertex and one index buffer,
+    // either straight from a mapped scene file or from the arrays above
+    // ------------------------------------------------------------------
+    StaticGeometry environment;
+    SceneFile scene;
+    StaticGeometryBuilder environmentBuilder(5, { { 0, 3, 0 }, { 1, 2, 3 } });
+    bool sceneLoaded = scenePath && scene.open(scenePath) && scene.upload(sceneObjectNames, OBJECT_COUNT, environment);
+    if (!sceneLoaded)
+    {
+        // added in SceneObject order, so the range ids are the enum values
+        environmentBuilder.add(base, sizeof(base));
+        environmentBuilder.add(leftRoad, sizeof(leftRoad));
+        environmentBuilder.add(rightRoad, sizeof(rightRoad));
+        environmentBuilder.add(grass, sizeof(grass));
+        environmentBuilder.add(yard, sizeof(yard));
+        environmentBuilder.add(backWall, sizeof(backWall));
+        environmentBuilder.add(frontWall, sizeof(frontWall));
+        environmentBuilder.add(leftWall, sizeof(leftWall));
+        environmentBuilder.add(rightWall, sizeof(rightWall));
+        environmentBuilder.add(backWallYard, sizeof(backWallYard));
+        environmentBuilder.add(frontWallYard, sizeof(frontWallYard));
+        environmentBuilder.add(leftWallYard, sizeof(leftWallYard));
+        environmentBuilder.add(rightWallYard, sizeof(rightWallYard));
+        environmentBuilder.add(gate, sizeof(gate));
+        environmentBuilder.add(boxVertices, sizeof(boxVertices)); // the box is packed but not drawn yet
+        ProceduralMesh octagon = generatePrism(octagonOutline, 1.0f, true);
+        ProceduralMesh insideOctagon = generatePrism(octagonOutline, 1.0f, false);
+        std::vector<float> octagonVertices = positionTexCoordVertices(octagon);
+        std::vector<float> insideOctagonVertices = positionTexCoordVertices(insideOctagon);
+        environmentBuilder.addIndexed(&octagonVertices[0], octagonVertices.size() * sizeof(float), &octagon.indices[0], (unsigned int)octagon.indices.size());
+        environmentBuilder.addIndexed(&insideOctagonVertices[0], insideOctagonVertices.size() * sizeof(float), &insideOctagon.indices[0], (unsigned int)insideOctagon.indices.size());
+        environment = environmentBuilder.build();
+    }
+    if (exportScenePath)
+    {
+        if (sceneLoaded)
+            std::cout << "--export-scene writes the built-in scene, ignoring it next to --scene" << std::endl;
+        else if (writeSceneFile(exportScenePath, environmentBuilder, std::vector<std::string>(sceneObjectNames, sceneObjectNames + OBJECT_COUNT)))
+            std::cout << "Exported the scene to " << exportScenePath << std::endl;
+    }
+    if (profile)
+    {
+        const std::vector<MeshOptimizationReport>& reports = environmentBuilder.optimizationReports();
+        for (size_t i = 0; i < reports.size(); ++i)
+            reports[i].print(std::cout, sceneObjectNames[i]);
+    }
+    // where the layered copy below reads the environment from
+    const float* environmentVertices = sceneLoaded ? scene.vertices() : &environmentBuilder.vertexData()[0];
+    // index i of the environment, whichever size the scene file stores it in
+    auto environmentIndex = [&](unsigned int i) { return sceneLoaded ? scene.index(i) : environmentBuilder.indexData()[i]; };
+    const unsigned int environmentVertexSize = sceneLoaded ? scene.vertexSize() : environmentBuilder.vertexSize();
+
+    // objects that share a texture go out in one multi-draw
+    DrawBatch roadBatch = environment.makeBatch({ OBJECT_LEFT_ROAD, OBJECT_RIGHT_ROAD });
+    DrawBatch wallBatch = environment.makeBatch({ OBJECT_BACK_WALL, OBJECT_FRONT_WALL, OBJECT_LEFT_WALL, OBJECT_RIGHT_WALL });
+    DrawBatch yardWallBatch = environment.makeBatch({ OBJECT_BACK_WALL_YARD, OBJECT_FRONT_WALL_YARD, OBJECT_LEFT_WALL_YARD, OBJECT_RIGHT_WALL_YARD });
+
+    RenderQueue renderQueue;
+    FrameProfiler profiler;
+    if (profile)
+        profiler.init(profileCsv);
+    double lastSummary = 0.0;
     // load textures
     // -------------
     vector<std::string> faces
@@ -1073,40 +789,263 @@ int main()
         FileSystem::getPath("resources/textures/skybox/back.png"),
     };
   
-    unsigned int cubemapTexture = loadCubemap(faces);
+    // decode every startup texture in parallel before anything asks for it;
+    // the cylinder and octagon textures are stored flipped
+    std::vector<TextureRequest> startupTextures = {
+        { FileSystem::getPath("resources/textures/gold.jpg"), false },
+        { FileSystem::getPath("resources/textures/mosaic.jpg"), true },
+        { FileSystem::getPath("resources/textures/dome1.png"), true },
+        { FileSystem::getPath("resources/textures/in.jpg"), true },
+    };
+    if (!useTextureArray)
+    {
+        const char* environmentTextures[] = { "sand.jpg", "grass.png", "yard.png", "wall.png", "yardWall.png", "gate.png", "road.jpg" };
+        for (const char* name : environmentTextures)
+            startupTextures.push_back({ FileSystem::getPath(std::string("resources/textures/") + name), false });
+    }
+    // interactive runs show the first frame right away and let the textures
+    // stream in; the benchmark needs every frame complete, so it waits
+    TextureStreamer textureStreamer(workers);
+    textureStreamer.create();
+    if (bench)
+        textureManager.preload(startupTextures, workers, uploadTexture, loadCompiledTexture);
+    else
+        textureManager.stream(startupTextures, textureStreamer);
 
-    unsigned int floorTexture = loadTexture(FileSystem::getPath("resources/textures/sand.jpg").c_str());
-    unsigned int grassTexture = loadTexture(FileSystem::getPath("resources/textures/grass.png").c_str());
-    unsigned int yardTexture = loadTexture(FileSystem::getPath("resources/textures/yard.png").c_str());
-    unsigned int wallTexture = loadTexture(FileSystem::getPath("resources/textures/wall.png").c_str());
-    unsigned int yardWallTexture = loadTexture(FileSystem::getPath("resources/textures/yardWall.png").c_str());
-    unsigned int gateTexture = loadTexture(FileSystem::getPath("resources/textures/gate.png").c_str());
-    unsigned int goldTexture = loadTexture(FileSystem::getPath("resources/textures/gold.jpg").c_str());
-    unsigned int roadTexture = loadTexture(FileSystem::getPath("resources/textures/road.jpg").c_str());
+    if (skyboxPath)
+        faces = { skyboxPath };
+    unsigned int cubemapTexture = loadCubemap2(faces);
+
+    unsigned int goldTexture = textureManager.acquire(FileSystem::getPath("resources/textures/gold.jpg"));
+
+    // the ground and wall materials are either separate textures or layers of one array
+    unsigned int floorTexture = 0, grassTexture = 0, yardTexture = 0, wallTexture = 0, yardWallTexture = 0, gateTexture = 0, roadTexture = 0;
+    MaterialArray materials(1024, 1024);
+    StaticGeometry layeredEnvironment;
+    DrawBatch layeredBatch;
+    unsigned int pillarMaterials[2] = { 0, 0 };
+    if (useTextureArray)
+    {
+        struct Surface {
+            SceneObject object;
+            const char* texture;
+        };
+        Surface surfaces[] = {
+            { OBJECT_BASE, "resources/textures/sand.jpg" },
+            { OBJECT_LEFT_ROAD, "resources/textures/road.jpg" },
+            { OBJECT_RIGHT_ROAD, "resources/textures/road.jpg" },
+            { OBJECT_GRASS, "resources/textures/grass.png" },
+            { OBJECT_YARD, "resources/textures/yard.png" },
+            { OBJECT_BACK_WALL, "resources/textures/wall.png" },
+            { OBJECT_FRONT_WALL, "resources/textures/wall.png" },
+            { OBJECT_LEFT_WALL, "resources/textures/wall.png" },
+            { OBJECT_RIGHT_WALL, "resources/textures/wall.png" },
+            { OBJECT_BACK_WALL_YARD, "resources/textures/yardWall.png" },
+            { OBJECT_FRONT_WALL_YARD, "resources/textures/yardWall.png" },
+            { OBJECT_LEFT_WALL_YARD, "resources/textures/yardWall.png" },
+            { OBJECT_RIGHT_WALL_YARD, "resources/textures/yardWall.png" },
+            { OBJECT_GATE, "resources/textures/gate.png" },
+        };
+        StaticGeometryBuilder layeredBuilder(6, { { 0, 3, 0 }, { 1, 2, 3 }, { 3, 1, 5 } });
+        std::vector<unsigned int> layeredRanges;
+        for (const Surface& surface : surfaces)
+        {
+            const DrawRange& range = environment.ranges[surface.object];
+            std::vector<float> vertices = appendLayer(environmentVertices + range.firstVertex * environmentVertexSize, range.vertexCount * environmentVertexSize * sizeof(float),
+                                                      materials.add(FileSystem::getPath(surface.texture)));
+            std::vector<unsigned int> indices;
+            for (unsigned int i = 0; i < range.indexCount; ++i)
+                indices.push_back(environmentIndex(range.firstIndex + i) - range.firstVertex);
+            layeredRanges.push_back(layeredBuilder.addIndexed(&vertices[0], vertices.size() * sizeof(float), &indices[0], range.indexCount));
+        }
+        pillarMaterials[0] = materials.add(FileSystem::getPath("resources/textures/wall.png"));
+        pillarMaterials[1] = materials.add(FileSystem::getPath("resources/textures/yardWall.png"));
+        materials.build(workers);
+        layeredEnvironment = layeredBuilder.build();
+        layeredBatch = layeredEnvironment.makeBatch(layeredRanges);
+    }
+    else
+    {
+        floorTexture = textureManager.acquire(FileSystem::getPath("resources/textures/sand.jpg"));
+        grassTexture = textureManager.acquire(FileSystem::getPath("resources/textures/grass.png"));
+        yardTexture = textureManager.acquire(FileSystem::getPath("resources/textures/yard.png"));
+        wallTexture = textureManager.acquire(FileSystem::getPath("resources/textures/wall.png"));
+        yardWallTexture = textureManager.acquire(FileSystem::getPath("resources/textures/yardWall.png"));
+        gateTexture = textureManager.acquire(FileSystem::getPath("resources/textures/gate.png"));
+        roadTexture = textureManager.acquire(FileSystem::getPath("resources/textures/road.jpg"));
+    }
+    cylinderTexture = textureManager.acquire(FileSystem::getPath("resources/textures/mosaic.jpg"));
+    domeTexture = textureManager.acquire(FileSystem::getPath("resources/textures/dome1.png"));
+    insideOctagonTexture = textureManager.acquire(FileSystem::getPath("resources/textures/in.jpg"));
+
+    // upload the retained meshes
+    // --------------------------
+    BoundingSphere cylinderBounds = setupCylinderMesh();
+    BoundingSphere domeBounds = setupSphereMesh();
+    BoundingSphere pillarBounds = setupPillarMesh();
+    if (profile)
+        for (const std::pair<std::string, MeshOptimizationReport>& report : proceduralMeshReports)
+            report.second.print(std::cout, report.first.c_str());
+    LodStats lodStats;
+
+    // where the dome pieces stand; the rest of the environment is drawn untransformed
+    glm::mat4 cylinderModel = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, -0.2f, 0.0f));
+    glm::mat4 sphereModel = glm::scale(glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, -0.15f, 0.0f)), glm::vec3(0.35f));
+    glm::mat4 octagonModel = glm::scale(glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, -0.79f, 0.0f)), glm::vec3(0.35f * 1.7f));
+    glm::mat4 insideOctagonModel = glm::scale(octagonModel, glm::vec3(0.9f));
+    BoundingSphere cylinderWorldBounds = transformSphere(cylinderModel, cylinderBounds);
+    BoundingSphere domeWorldBounds = transformSphere(sphereModel, domeBounds);
+
+    // the colonnade: every pillar in one instanced draw, all at the level of
+    // detail the nearest one needs
+    std::vector<InstanceData> pillars = colonnadeInstances(16, 0.8f, pillarMaterials);
+    InstanceBuffer pillarInstances;
+    pillarInstances.upload(pillars);
+    for (unsigned int level = 0; level < pillarLod.size(); ++level)
+        meshRegistry.attachInstances(pillarLod.level(level).mesh, pillarInstances);
+    std::vector<BoundingSphere> pillarWorldBounds;
+    for (const InstanceData& pillar : pillars)
+        pillarWorldBounds.push_back(transformSphere(pillar.model, pillarBounds));
+
+    // texture residency: every texture with the world-space bounds of what it is drawn on
+    // ------------------------------------------------------------------------------------
+    ResidencyManager residency(workers, (size_t)textureBudget * 1024 * 1024);
+    std::vector<BoundingSphere> objectBounds;
+    for (const DrawRange& range : environment.ranges)
+        objectBounds.push_back(computeBoundingSphere(environmentVertices, environmentVertexSize, range));
+    struct TexturePlacement {
+        unsigned int texture;
+        const char* path;
+        bool flip;
+        std::vector<BoundingSphere> bounds;
+    };
+    std::vector<TexturePlacement> placements = {
+        { goldTexture, "resources/textures/gold.jpg", false, { domeWorldBounds } },
+        { cylinderTexture, "resources/textures/mosaic.jpg", true, { cylinderWorldBounds } },
+        { domeTexture, "resources/textures/dome1.png", true, { transformSphere(octagonModel, objectBounds[OBJECT_OCTAGON]) } },
+        { insideOctagonTexture, "resources/textures/in.jpg", true, { transformSphere(insideOctagonModel, objectBounds[OBJECT_INSIDE_OCTAGON]) } },
+    };
+    if (useTextureArray)
+        residency.trackFixed(materials.ID, GL_TEXTURE_2D_ARRAY);
+    else
+    {
+        // without the array the pillars share the cylinder's mosaic
+        placements[1].bounds.insert(placements[1].bounds.end(), pillarWorldBounds.begin(), pillarWorldBounds.end());
+        placements.push_back({ floorTexture, "resources/textures/sand.jpg", false, { objectBounds[OBJECT_BASE] } });
+        placements.push_back({ roadTexture, "resources/textures/road.jpg", false, { objectBounds[OBJECT_LEFT_ROAD], objectBounds[OBJECT_RIGHT_ROAD] } });
+        placements.push_back({ grassTexture, "resources/textures/grass.png", false, { objectBounds[OBJECT_GRASS] } });
+        placements.push_back({ yardTexture, "resources/textures/yard.png", false, { objectBounds[OBJECT_YARD] } });
+        placements.push_back({ wallTexture, "resources/textures/wall.png", false,
+                               { objectBounds[OBJECT_BACK_WALL], objectBounds[OBJECT_FRONT_WALL], objectBounds[OBJECT_LEFT_WALL], objectBounds[OBJECT_RIGHT_WALL] } });
+        placements.push_back({ yardWallTexture, "resources/textures/yardWall.png", false,
+                               { objectBounds[OBJECT_BACK_WALL_YARD], objectBounds[OBJECT_FRONT_WALL_YARD], objectBounds[OBJECT_LEFT_WALL_YARD], objectBounds[OBJECT_RIGHT_WALL_YARD] } });
+        placements.push_back({ gateTexture, "resources/textures/gate.png", false, { objectBounds[OBJECT_GATE] } });
+    }
+    for (const TexturePlacement& placement : placements)
+        residency.track(placement.texture, FileSystem::getPath(placement.path), placement.flip, placement.bounds);
+    residency.trackFixed(cubemapTexture, GL_TEXTURE_CUBE_MAP);
+    scene.close();
 
     // shader configuration
     // --------------------
-    shader.use();
-    shader.setInt("skybox", 0);
-    skyboxShader.use();
-    skyboxShader.setInt("skybox", 0);
-    ourShader.use();
-    ourShader.setInt("texture1", 0);
+    CameraUniforms cameraUniforms;
+    cameraUniforms.create();
+    // draws without an instance buffer read an identity instance matrix
+    setDefaultInstanceAttributes();
+    // what every program needs once after linking, again after a hot reload.
+    // each samples its one texture from unit 0; names a program doesn't
+    // have resolve to -1, which glUniform ignores
+    auto configureProgram = [&cameraUniforms](ShaderProgram& program) {
+        cameraUniforms.bind(program);
+        program.use();
+        program.setInt("skybox", 0);
+        program.setInt("texture1", 0);
+        program.setInt("materials", 0);
+    };
+    ShaderProgram* materialShader = NULL;
+    if (useTextureArray)
+    {
+        materialShader = &shaderCache.get("1.1.depth_testing_array.vs", "1.1.depth_testing_array.fs");
+        configureProgram(*materialShader);
+    }
+    configureProgram(shader);
+    configureProgram(skyboxShader);
+    configureProgram(ourShader);
+    shaderCache.print(std::cout);
+
+    // interactive runs watch the shaders (loaded relative to the working
+    // directory) and the texture tree, and reload whatever gets saved
+    FileWatcher fileWatcher;
+    if (!bench && !assetBundle.isOpen()) // edits to the files wouldn't show through the bundle
+    {
+        fileWatcher.watch(".", false);
+        fileWatcher.watch(FileSystem::getPath("resources/textures"), true);
+    }
 
+    if (replayPath && !inputReplay.open(replayPath, camera))
+        return -1;
+    if (recordPath && !bench && !inputReplay.isActive())
+        inputRecorder.open(recordPath, camera, glfwGetTime());
+
+    OffscreenTarget offscreen;
+    std::vector<double> benchTimes;
+    if (bench && !offscreen.create(SCR_WIDTH, SCR_HEIGHT))
+        return -1;
 
     // render loop
     // -----------
-    while (!glfwWindowShouldClose(window))
+    int benchFrame = 0;
+    while (bench ? benchFrame < benchFrames : !glfwWindowShouldClose(window))
     {
-        // per-frame time logic
+        // per-frame time logic; the benchmark runs on a fixed 60 Hz clock
         // --------------------
-        float currentFrame = static_cast<float>(glfwGetTime());
+        std::chrono::steady_clock::time_point frameStart = std::chrono::steady_clock::now();
+        float currentFrame = bench ? benchFrame * InputReplay::STEP : static_cast<float>(glfwGetTime());
         deltaTime = currentFrame - lastFrame;
         lastFrame = currentFrame;
 
         // input
         // -----
-        processInput(window);
+        if (!bench)
+            processInput(window);
+        if (inputReplay.isActive())
+        {
+            // the run ends with the recording
+            if (!inputReplay.advance(camera))
+                break;
+        }
+        else if (bench)
+            benchmarkCamera(camera, benchFrame, benchFrames);
+
+        // hot reload: only the programs and textures that use a saved file
+        for (const std::string& path : fileWatcher.poll())
+        {
+            for (ShaderProgram* program : shaderCache.reload(path))
+            {
+                configureProgram(*program);
+                std::cout << "Reloaded " << program->vertexPath << " + " << program->fragmentPath << std::endl;
+            }
+            if (textureManager.reload(path, workers) || (useTextureArray && materials.reload(path, workers)))
+                continue;
+            if (std::find(faces.begin(), faces.end(), path) != faces.end())
+            {
+                unsigned int skybox = loadCubemap2(faces);
+                if (skybox)
+                {
+                    residency.retarget(cubemapTexture, skybox);
+                    glDeleteTextures(1, &cubemapTexture);
+                    cubemapTexture = skybox;
+                }
+            }
+        }
+
+        // bounded texture uploads, so big textures never stall a frame
+        unsigned int streamed = textureStreamer.texturesCompleted;
+        textureStreamer.update();
+        if (textureManager.update() > 0 || textureStreamer.texturesCompleted != streamed)
+            residency.invalidate();
+        if (useTextureArray)
+            materials.update();
 
         // render
         // ------
@@ -1115,231 +1054,179 @@ int main()
 
         // draw scene as normal
         //shader.use();
-        glm::mat4 model = glm::mat4(1.0f);
         glm::mat4 view = camera.GetViewMatrix();
         glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f);
-       // view = glm::translate(view, glm::vec3(0.0f, 0.0f, -3.0f));
-        ourShader.use();
-        ourShader.setMat4("view", view);
-        ourShader.setMat4("projection", projection);
-        glBindVertexArray(VAO);
-        glBindTexture(GL_TEXTURE_2D, floorTexture);
-        ourShader.setMat4("model", glm::mat4(1.0f));
-        glDrawArrays(GL_TRIANGLES, 0, 6);
-        glBindVertexArray(0);
-        ourShader.use();
-        ourShader.setMat4("view", view);
-        ourShader.setMat4("projection", projection);
-        glBindVertexArray(leftRoadVAO);
-        glBindTexture(GL_TEXTURE_2D, roadTexture);
-        ourShader.setMat4("model", glm::mat4(1.0f));
-        glDrawArrays(GL_TRIANGLES, 0, 6);
-        ourShader.use();
-        ourShader.setMat4("view", view);
-        ourShader.setMat4("projection", projection);
-        glBindVertexArray(rightRoadVAO);
-        glBindTexture(GL_TEXTURE_2D, roadTexture);
-        ourShader.setMat4("model", glm::mat4(1.0f));
-        glDrawArrays(GL_TRIANGLES, 0, 6);
-        glBindVertexArray(0);
-        ourShader.use();
-        ourShader.setMat4("view", view);
-        ourShader.setMat4("projection", projection);
-        glBindVertexArray(VAO);
-        glBindVertexArray(grassVAO);
-        glBindTexture(GL_TEXTURE_2D, grassTexture);
-        ourShader.setMat4("model", glm::mat4(1.0f));
-        glDrawArrays(GL_TRIANGLES, 0, 6);
-        glBindVertexArray(0);
-        ourShader.use();
-
-        ourShader.setMat4("view", view);
-        ourShader.setMat4("projection", projection);
-        glBindVertexArray(VAO);
-        glBindVertexArray(yardVAO);
-        glBindTexture(GL_TEXTURE_2D, yardTexture);
-        ourShader.setMat4("model", glm::mat4(1.0f));
-        glDrawArrays(GL_TRIANGLES, 0, 6);
-        glBindVertexArray(0);
-       ourShader.use();
-        ourShader.setMat4("view", view);
-        ourShader.setMat4("projection", projection);
-        glBindVertexArray(VAO);
-        glBindVertexArray(backWallVAO);
-        glBindTexture(GL_TEXTURE_2D, wallTexture);
-        ourShader.setMat4("model", glm::mat4(1.0f));
-        glDrawArrays(GL_TRIANGLES, 0, 6);
-        glBindVertexArray(0);
-        ourShader.use();
-        ourShader.setMat4("view", view);
-        ourShader.setMat4("projection", projection);
-        glBindVertexArray(VAO);
-        glBindVertexArray(frontWallVAO);
-        glBindTexture(GL_TEXTURE_2D, wallTexture);
-        ourShader.setMat4("model", glm::mat4(1.0f));
-        glDrawArrays(GL_TRIANGLES, 0, 6);
-        glBindVertexArray(0);
-        ourShader.use();
-        ourShader.setMat4("view", view);
-        ourShader.setMat4("projection", projection);
-        glBindVertexArray(VAO);
-        glBindVertexArray(leftWallVAO);
-        glBindTexture(GL_TEXTURE_2D, wallTexture);
-        ourShader.setMat4("model", glm::mat4(1.0f));
-        glDrawArrays(GL_TRIANGLES, 0, 6);
-        glBindVertexArray(0);
-        ourShader.use();
-        ourShader.setMat4("view", view);
-        ourShader.setMat4("projection", projection);
-        glBindVertexArray(VAO);
-        glBindVertexArray(rightWallVAO);
-        glBindTexture(GL_TEXTURE_2D, wallTexture);
-        ourShader.setMat4("model", glm::mat4(1.0f));
-        glDrawArrays(GL_TRIANGLES, 0, 6);
-        glBindVertexArray(0);
-        ourShader.use();
-        ourShader.setMat4("view", view);
-        ourShader.setMat4("projection", projection);
-        glBindVertexArray(VAO);
-        glBindVertexArray(backWallYardVAO);
-        glBindTexture(GL_TEXTURE_2D, yardWallTexture);
-        ourShader.setMat4("model", glm::mat4(1.0f));
-        glDrawArrays(GL_TRIANGLES, 0, 6);
-        glBindVertexArray(0);
-        ourShader.use();
-        ourShader.setMat4("view", view);
-        ourShader.setMat4("projection", projection);
-        glBindVertexArray(VAO);
-        glBindVertexArray(frontWallYardVAO);
-        glBindTexture(GL_TEXTURE_2D, yardWallTexture);
-        ourShader.setMat4("model", glm::mat4(1.0f));
-        glDrawArrays(GL_TRIANGLES, 0, 12);
-        glBindVertexArray(0);
-        ourShader.use();
-        ourShader.setMat4("view", view);
-        ourShader.setMat4("projection", projection);
-        glBindVertexArray(VAO);
-        glBindVertexArray(leftWallYardVAO);
-        glBindTexture(GL_TEXTURE_2D, yardWallTexture);
-        ourShader.setMat4("model", glm::mat4(1.0f));
-        glDrawArrays(GL_TRIANGLES, 0, 6);
-        glBindVertexArray(0);
-        ourShader.use();
-        ourShader.setMat4("view", view);
-        ourShader.setMat4("projection", projection);
-        glBindVertexArray(VAO);
-        glBindVertexArray(rightWallYardVAO);
-        glBindTexture(GL_TEXTURE_2D, yardWallTexture);
-        ourShader.setMat4("model", glm::mat4(1.0f));
-        glDrawArrays(GL_TRIANGLES, 0, 6);
-        glBindVertexArray(0);
-        ourShader.use();
-        ourShader.setMat4("view", view);
-        ourShader.setMat4("projection", projection);
-        glBindVertexArray(gateVAO);
-        glBindTexture(GL_TEXTURE_2D, gateTexture);
-        ourShader.setMat4("model", glm::mat4(1.0f));
-        glDrawArrays(GL_TRIANGLES, 0, 6);
-        glBindVertexArray(0);
-        ourShader.use();
-        unsigned int modelLoc = glGetUniformLocation(ourShader.ID, "model");
-        unsigned int viewLoc = glGetUniformLocation(ourShader.ID, "view");
-        model = glm::scale(model, glm::vec3(0.35f, 0.35f, 0.35f));
-       view = glm::translate(view, glm::vec3(0.0f, -0.2f, 0.0f));
-       glUniformMatrix4fv(viewLoc, 1, GL_FALSE, &view[0][0]);
-       ourShader.setMat4("projection", projection);
-        renderCylinder(); 
-        glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-        glBindVertexArray(0);
-        ourShader.use();
-        modelLoc = glGetUniformLocation(ourShader.ID, "model");
-        view = glm::translate(view, glm::vec3(0.0f, 0.05f, 0.0f));
-        ourShader.setMat4("view", view);
-        ourShader.setMat4("projection", projection);
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, goldTexture);
-        renderSphere();
-        glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-        glBindVertexArray(0);
-        ourShader.use();
-        modelLoc = glGetUniformLocation(ourShader.ID, "model");
-        view = glm::translate(camera.GetViewMatrix(), glm::vec3(0.0f, -0.79f, 0.0f));
-         model = glm::scale(model, glm::vec3(1.7f, 1.7f, 1.7f));
-        ourShader.setMat4("projection", projection);
-        renderOctagon(view,projection,model);
-        ourShader.setMat4("view", view);
-        glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-        glBindVertexArray(0);
-       ourShader.use();
-        modelLoc = glGetUniformLocation(ourShader.ID, "model");
-        view = glm::translate(camera.GetViewMatrix(), glm::vec3(0.0f, -0.79f, 0.0f));
-       model = glm::scale(model, glm::vec3(0.9f, 0.9, 0.9f));
-        ourShader.setMat4("projection", projection);
-        renderInsideOctagon(view, projection, model);
-        ourShader.setMat4("view", view);
-        glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-        glBindVertexArray(0);
-        glDepthFunc(GL_LEQUAL);  // change depth function so depth test passes when values are equal to depth buffer's content
-        skyboxShader.use();
-        projection = glm::perspective(glm::radians(camera.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f);
-        view = glm::mat4(glm::mat3(camera.GetViewMatrix())); // remove translation from the view matrix
-        skyboxShader.setMat4("view", view);
-        skyboxShader.setMat4("projection", projection);
-        // skybox cube
-        glBindVertexArray(skyboxVAO);
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_CUBE_MAP, cubemapTexture);
-        glDrawArrays(GL_TRIANGLES, 0, 36);
-        glBindVertexArray(0);
-        glDepthFunc(GL_LESS); // set depth function back to default
+        cameraUniforms.update(view, projection, camera.Position);
+        residency.update(projection * view, camera.Position);
+
+        // everything goes out in one sorted flush, so the queue can order the
+        // whole frame by state. only while profiling is every stage flushed on
+        // its own, to be timed separately; the queue then still skips state
+        // that carries over between stages
+        renderQueue.beginFrame();
+        profiler.beginFrame();
+        auto flushStage = [&renderQueue, &profiler]() {
+            if (profiler.isEnabled())
+                renderQueue.flush();
+        };
+        glm::mat4 identity = glm::mat4(1.0f);
+
+        // ground and walls
+        if (useTextureArray)
+        {
+            ScopedStageTimer timer(profiler, STAGE_GROUND);
+            DrawItem layered = makeDrawItem(materialShader, materials.ID, layeredEnvironment, layeredBatch, identity);
+            layered.textureTarget = GL_TEXTURE_2D_ARRAY;
+            renderQueue.submit(layered);
+            flushStage();
+        }
+        else
+        {
+            {
+                ScopedStageTimer timer(profiler, STAGE_GROUND);
+                renderQueue.submit(makeDrawItem(&ourShader, floorTexture, environment, OBJECT_BASE, identity));
+                renderQueue.submit(makeDrawItem(&ourShader, roadTexture, environment, roadBatch, identity));
+                renderQueue.submit(makeDrawItem(&ourShader, grassTexture, environment, OBJECT_GRASS, identity));
+                renderQueue.submit(makeDrawItem(&ourShader, yardTexture, environment, OBJECT_YARD, identity));
+                flushStage();
+            }
+            {
+                ScopedStageTimer timer(profiler, STAGE_WALLS);
+                renderQueue.submit(makeDrawItem(&ourShader, wallTexture, environment, wallBatch, identity));
+                renderQueue.submit(makeDrawItem(&ourShader, yardWallTexture, environment, yardWallBatch, identity));
+                renderQueue.submit(makeDrawItem(&ourShader, gateTexture, environment, OBJECT_GATE, identity));
+                flushStage();
+            }
+        }
+
+        // the dome: cylinder base and golden sphere, in as much detail as their size on screen needs
+        lodStats.beginFrame();
+        {
+            ScopedStageTimer timer(profiler, STAGE_CYLINDER);
+            unsigned int mesh = cylinderLod.update(projectedDiameter(cylinderWorldBounds, camera.Position, projection, (float)SCR_HEIGHT));
+            lodStats.count(cylinderLod);
+            renderQueue.submit(makeDrawItem(&ourShader, cylinderTexture, meshRegistry.get(mesh), cylinderModel));
+            flushStage();
+        }
+        {
+            ScopedStageTimer timer(profiler, STAGE_SPHERE);
+            unsigned int mesh = domeLod.update(projectedDiameter(domeWorldBounds, camera.Position, projection, (float)SCR_HEIGHT));
+            lodStats.count(domeLod);
+            renderQueue.submit(makeDrawItem(&ourShader, goldTexture, meshRegistry.get(mesh), sphereModel));
+            flushStage();
+        }
+
+        // the octagon and its inner walls
+        {
+            ScopedStageTimer timer(profiler, STAGE_OCTAGON);
+            renderQueue.submit(makeDrawItem(&ourShader, domeTexture, environment, OBJECT_OCTAGON, octagonModel));
+            flushStage();
+        }
+        {
+            ScopedStageTimer timer(profiler, STAGE_INTERIOR);
+            renderQueue.submit(makeDrawItem(&ourShader, insideOctagonTexture, environment, OBJECT_INSIDE_OCTAGON, insideOctagonModel));
+            flushStage();
+        }
+
+        {
+            ScopedStageTimer timer(profiler, STAGE_COLONNADE);
+            float pixels = 0.0f;
+            for (const BoundingSphere& bounds : pillarWorldBounds)
+                pixels = glm::max(pixels, projectedDiameter(bounds, camera.Position, projection, (float)SCR_HEIGHT));
+            unsigned int mesh = pillarLod.update(pixels);
+            lodStats.count(pillarLod, pillarInstances.count);
+            DrawItem colonnade = makeDrawItem(useTextureArray ? materialShader : &ourShader, useTextureArray ? materials.ID : cylinderTexture,
+                                              meshRegistry.get(mesh), identity);
+            if (useTextureArray)
+                colonnade.textureTarget = GL_TEXTURE_2D_ARRAY;
+            renderQueue.submit(colonnade);
+            flushStage();
+        }
+        renderQueue.flush();
+
+        {
+            ScopedStageTimer timer(profiler, STAGE_SKYBOX);
+            glDepthFunc(GL_LEQUAL);  // change depth function so depth test passes when values are equal to depth buffer's content
+            skyboxShader.use();
+            // skybox cube
+            glBindVertexArray(skyboxVAO);
+            glActiveTexture(GL_TEXTURE0);
+            glBindTexture(GL_TEXTURE_CUBE_MAP, cubemapTexture);
+            glDrawArrays(GL_TRIANGLES, 0, 36);
+            glBindVertexArray(0);
+            glDepthFunc(GL_LESS); // set depth function back to default
+        }
+        profiler.endFrame();
+        if (profiler.isEnabled() && currentFrame - lastSummary > 5.0)
+        {
+            profiler.printSummary(std::cout);
+            residency.print(std::cout);
+            lodStats.print(std::cout);
+            lastSummary = currentFrame;
+        }
 
        // glDepthFunc(GL_LEQUAL);  // change depth function so depth test passes when values are equal to depth buffer's content
 
       
 
 
+        if (bench)
+        {
+            // wait for the GPU so the frame time covers the whole frame
+            glFinish();
+            benchTimes.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - frameStart).count());
+            benchFrame++;
+            continue;
+        }
+
         // glfw: swap buffers and poll IO events (keys pressed/released, mouse moved etc.)
         // -------------------------------------------------------------------------------
         glfwSwapBuffers(window);
         glfwPollEvents();
     }
 
+    if (bench)
+    {
+        std::vector<unsigned char> pixels = offscreen.readPixels();
+        printBenchmark(benchTimes, fnv1a64(&pixels[0], pixels.size()));
+        offscreen.release();
+    }
+
+    // only recordings ask GLFW for the time; benchmark runs never initialize it
+    if (inputRecorder.isRecording())
+        inputRecorder.close(glfwGetTime());
+    renderQueue.stats.print(std::cout);
+    profiler.finish();
+    profiler.printSummary(std::cout);
+    residency.print(std::cout);
+    lodStats.print(std::cout);
+
     // optional: de-allocate all resources once they've outlived their purpose:
     // ------------------------------------------------------------------------
     glDeleteVertexArrays(1, &cubeVAO);
     glDeleteVertexArrays(1, &skyboxVAO);
-    glDeleteVertexArrays(1, &VAO);
-    glDeleteVertexArrays(1, &grassVAO);
-    glDeleteVertexArrays(1, &rightRoadVAO);
-    glDeleteVertexArrays(1, &leftRoadVAO);
-    glDeleteVertexArrays(1, &gateVAO);
-    glDeleteVertexArrays(1, &rightWallYardVAO);
-    glDeleteVertexArrays(1, &leftWallYardVAO);
-    glDeleteVertexArrays(1, &frontWallYardVAO);
-    glDeleteVertexArrays(1, &backWallYardVAO);
-    glDeleteVertexArrays(1, &backWallVAO);
-    glDeleteVertexArrays(1, &frontWallVAO);
-    glDeleteVertexArrays(1, &leftWallVAO);
-    glDeleteVertexArrays(1, &rightWallVAO);
     glDeleteBuffers(1, &cubeVBO);
     glDeleteBuffers(1, &skyboxVBO);
-    glDeleteBuffers(1, &VBO);
-    glDeleteBuffers(1, &grassVBO);
-    glDeleteBuffers(1, &rightRoadVBO);
-    glDeleteBuffers(1, &leftRoadVBO);
-    glDeleteBuffers(1, &gateVBO);
-    glDeleteBuffers(1, &rightWallYardVBO);
-    glDeleteBuffers(1, &leftWallYardVBO);
-    glDeleteBuffers(1, &frontWallYardVBO);
-    glDeleteBuffers(1, &backWallYardVBO);
-    glDeleteBuffers(1, &backWallVBO);
-    glDeleteBuffers(1, &frontWallVBO);
-    glDeleteBuffers(1, &leftWallVBO);
-    glDeleteBuffers(1, &rightWallVBO);
-
-
-
-    glfwTerminate();
+    environment.release();
+    if (useTextureArray)
+    {
+        layeredEnvironment.release();
+        materials.release();
+    }
+    pillarInstances.release();
+    meshRegistry.release();
+    residency.release();
+    textureStreamer.release();
+    textureManager.releaseAll();
+    cameraUniforms.release();
+    profiler.release();
+    shaderCache.release();
+    mountedAssetBundle() = NULL;
+
+    if (bench)
+        headless.release();
+    else
+        glfwTerminate();
     return 0;
 }
 
@@ -1350,14 +1237,32 @@ void processInput(GLFWwindow *window)
     if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
         glfwSetWindowShouldClose(window, true);
 
+    // a replay owns the camera
+    if (inputReplay.isActive())
+        return;
+
+    unsigned char keys = 0;
     if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS)
+    {
         camera.ProcessKeyboard(FORWARD, deltaTime);
+        keys |= INPUT_KEY_FORWARD;
+    }
     if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS)
+    {
         camera.ProcessKeyboard(BACKWARD, deltaTime);
+        keys |= INPUT_KEY_BACKWARD;
+    }
     if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS)
+    {
         camera.ProcessKeyboard(LEFT, deltaTime);
+        keys |= INPUT_KEY_LEFT;
+    }
     if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
+    {
         camera.ProcessKeyboard(RIGHT, deltaTime);
+        keys |= INPUT_KEY_RIGHT;
+    }
+    inputRecorder.keys(glfwGetTime(), keys);
 }
 
 // glfw: whenever the window size changed (by OS or user resize) this callback function executes
@@ -1388,90 +1293,85 @@ void mouse_callback(GLFWwindow* window, double xposIn, double yposIn)
     lastX = xpos;
     lastY = ypos;
 
+    if (inputReplay.isActive())
+        return;
     camera.ProcessMouseMovement(xoffset, yoffset);
+    inputRecorder.mouse(glfwGetTime(), xoffset, yoffset);
 }
 
 // glfw: whenever the mouse scroll wheel scrolls, this callback is called
 // ----------------------------------------------------------------------
 void scroll_callback(GLFWwindow* window, double xoffset, double yoffset)
 {
+    if (inputReplay.isActive())
+        return;
     camera.ProcessMouseScroll(static_cast<float>(yoffset));
+    inputRecorder.scroll(glfwGetTime(), static_cast<float>(yoffset));
 }
 
 // utility function for loading a 2D texture from file
 // ---------------------------------------------------
 unsigned int loadTexture(char const * path)
+{
+    // textures compiled by texture_compiler come with their mips and stay compressed on the GPU
+    unsigned int compiled = loadCompiledTexture(path, false);
+    if (compiled)
+        return compiled;
+
+    DecodedImage image = decodeTexture(path, false);
+    unsigned int textureID = uploadTexture(image);
+    freeImage(image);
+    return textureID;
+}
+
+// uploads a decoded image as a mipmapped 2D texture; must run on the GL thread
+// -----------------------------------------------------------------------------
+unsigned int uploadTexture(const DecodedImage& image)
 {
     unsigned int textureID;
     glGenTextures(1, &textureID);
 
-    int width, height, nrComponents;
-    unsigned char *data = stbi_load(path, &width, &height, &nrComponents, 0);
-    if (data)
+    if (image.data)
     {
-        GLenum format;
-        if (nrComponents == 1)
-            format = GL_RED;
-        else if (nrComponents == 3)
-            format = GL_RGB;
-        else if (nrComponents == 4)
-            format = GL_RGBA;
-
         glBindTexture(GL_TEXTURE_2D, textureID);
-        glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
+        uploadImageLevels(image);
 
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-        stbi_image_free(data);
     }
     else
     {
-        std::cout << "Texture failed to load at path: " << path << std::endl;
-        stbi_image_free(data);
+        std::cout << "Texture failed to load at path: " << image.path << std::endl;
     }
 
     return textureID;
 }
 
-// loads a cubemap texture from 6 individual texture faces
-// order:
-// +X (right)
-// -X (left)
-// +Y (top)
-// -Y (bottom)
-// +Z (front) 
-// -Z (back)
-// -------------------------------------------------------
-unsigned int loadCubemap(vector<std::string> faces)
+// loads a cubemap. faces is either the six face files (+X right, -X left,
+// +Y top, -Y bottom, +Z front, -Z back) or one file: a compiled cube .dds,
+// or a 4x3 / 3x4 cross or 2:1 equirectangular image that gets split into
+// faces. faces are decoded / resampled in parallel and stored in immutable
+// storage with a full mip chain.
+// -------------------------------------------------------------------------
+unsigned int loadCubemap2(vector<std::string> faces)
 {
-    unsigned int textureID;
-    glGenTextures(1, &textureID);
-    glBindTexture(GL_TEXTURE_CUBE_MAP, textureID);
-
-    int width, height, nrComponents;
-    for (unsigned int i = 0; i < faces.size(); i++)
+    DDSImage cube;
+    if (faces.size() == 1)
     {
-        unsigned char *data = stbi_load(faces[i].c_str(), &width, &height, &nrComponents, 3);
-        if (data)
-        {
-            glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
-            stbi_image_free(data);
-        }
-        else
-        {
-            std::cout << "Cubemap texture failed to load at path: " << faces[i] << std::endl;
-            stbi_image_free(data);
-        }
+        const std::string& path = faces[0];
+        bool isDDS = path.size() > 4 && path.compare(path.size() - 4, 4, ".dds") == 0;
+        if (supportsS3TC() && (isDDS || compiledTextureIsCurrent(path)) && readDDS(isDDS ? path : compiledTexturePath(path), cube) && cube.faces == 6)
+            return createCompressedCubemap(cube);
     }
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
-
-    return textureID;
+    else if (readCompiledCubemapFaces(faces, cube))
+        return createCompressedCubemap(cube);
+
+    std::vector<std::vector<unsigned char> > decoded;
+    int size = 0;
+    bool ok = faces.size() == 1 ? splitCubemapImage(faces[0], workers, decoded, size) : decodeCubemapFaces(faces, workers, decoded, size);
+    if (!ok)
+        return 0;
+    return createCubemap(decoded, size);
 }
@@ -0,0 +1,190 @@
+#ifndef DDS_FILE_H
+#define DDS_FILE_H
+
+#include "asset_bundle.h"
+
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// DirectDraw Surface container holding BC1 (DXT1) or BC3 (DXT5) blocks with a
+// full mip chain, as written by texture_compiler. only the subset of the
+// format we produce ourselves is understood: 2D or a full cube, FourCC
+// compressed, no DX10 extension header.
+#define DDS_FOURCC(a, b, c, d) ((unsigned int)(a) | ((unsigned int)(b) << 8) | ((unsigned int)(c) << 16) | ((unsigned int)(d) << 24))
+
+const unsigned int DDS_MAGIC = DDS_FOURCC('D', 'D', 'S', ' ');
+const unsigned int DDS_DXT1 = DDS_FOURCC('D', 'X', 'T', '1');
+const unsigned int DDS_DXT5 = DDS_FOURCC('D', 'X', 'T', '5');
+// stored in reserved1[0] by texture_compiler when the rows were flipped
+const unsigned int DDS_FLIPPED = DDS_FOURCC('F', 'L', 'I', 'P');
+
+const unsigned int DDSD_CAPS = 0x1;
+const unsigned int DDSD_HEIGHT = 0x2;
+const unsigned int DDSD_WIDTH = 0x4;
+const unsigned int DDSD_PIXELFORMAT = 0x1000;
+const unsigned int DDSD_MIPMAPCOUNT = 0x20000;
+const unsigned int DDSD_LINEARSIZE = 0x80000;
+const unsigned int DDPF_FOURCC = 0x4;
+const unsigned int DDSCAPS_COMPLEX = 0x8;
+const unsigned int DDSCAPS_TEXTURE = 0x1000;
+const unsigned int DDSCAPS_MIPMAP = 0x400000;
+const unsigned int DDSCAPS2_CUBEMAP = 0x200;
+const unsigned int DDSCAPS2_CUBEMAP_ALLFACES = 0xFC00;
+
+struct DDSPixelFormat {
+    unsigned int size;
+    unsigned int flags;
+    unsigned int fourCC;
+    unsigned int rgbBitCount;
+    unsigned int rBitMask, gBitMask, bBitMask, aBitMask;
+};
+
+struct DDSHeader {
+    unsigned int size;
+    unsigned int flags;
+    unsigned int height;
+    unsigned int width;
+    unsigned int pitchOrLinearSize;
+    unsigned int depth;
+    unsigned int mipMapCount;
+    unsigned int reserved1[11];
+    DDSPixelFormat pixelFormat;
+    unsigned int caps, caps2, caps3, caps4;
+    unsigned int reserved2;
+};
+
+// one mip level of the first face inside DDSImage::data
+struct DDSLevel {
+    int width;
+    int height;
+    size_t offset;
+    size_t size;
+};
+
+struct DDSImage {
+    int width;
+    int height;
+    unsigned int fourCC;  // DDS_DXT1 or DDS_DXT5
+    bool flipped;         // rows are stored bottom-up
+    int faces;            // 1, or 6 for a cubemap (+X, -X, +Y, -Y, +Z, -Z)
+    std::vector<DDSLevel> levels;
+    std::vector<unsigned char> data;
+
+    // bytes of one face with all its mips
+    size_t faceSize() const
+    {
+        return levels.empty() ? 0 : levels.back().offset + levels.back().size;
+    }
+
+    const unsigned char* levelData(int face, int level) const
+    {
+        return &data[face * faceSize() + levels[level].offset];
+    }
+};
+
+// bytes of one 4x4 block
+inline size_t ddsBlockSize(unsigned int fourCC)
+{
+    return fourCC == DDS_DXT1 ? 8 : 16;
+}
+
+inline size_t ddsLevelSize(int width, int height, unsigned int fourCC)
+{
+    return (size_t)((width + 3) / 4) * ((height + 3) / 4) * ddsBlockSize(fourCC);
+}
+
+// checks a header written by writeDDS and lays out the image's levels and
+// faces; returns the bytes of block data that follow the header
+// ---------------------------------------------------------------------------
+inline size_t readDDSHeader(unsigned int magic, const DDSHeader& header, DDSImage& image)
+{
+    if (magic != DDS_MAGIC || header.size != sizeof(DDSHeader) || !(header.pixelFormat.flags & DDPF_FOURCC) ||
+        (header.pixelFormat.fourCC != DDS_DXT1 && header.pixelFormat.fourCC != DDS_DXT5))
+        return 0;
+
+    image.width = (int)header.width;
+    image.height = (int)header.height;
+    image.fourCC = header.pixelFormat.fourCC;
+    image.flipped = header.reserved1[0] == DDS_FLIPPED;
+    bool cube = (header.caps2 & DDSCAPS2_CUBEMAP) != 0;
+    if (cube && (header.caps2 & DDSCAPS2_CUBEMAP_ALLFACES) != DDSCAPS2_CUBEMAP_ALLFACES)
+        return 0; // partial cubes are not supported
+    image.faces = cube ? 6 : 1;
+    image.levels.clear();
+    unsigned int mipCount = (header.flags & DDSD_MIPMAPCOUNT) && header.mipMapCount ? header.mipMapCount : 1;
+    size_t offset = 0;
+    int w = image.width, h = image.height;
+    for (unsigned int i = 0; i < mipCount; ++i)
+    {
+        DDSLevel level = { w, h, offset, ddsLevelSize(w, h, image.fourCC) };
+        image.levels.push_back(level);
+        offset += level.size;
+        w = w > 1 ? w / 2 : 1;
+        h = h > 1 ? h / 2 : 1;
+    }
+    return offset * image.faces;
+}
+
+// reads a file written by writeDDS, from the mounted asset bundle if it holds
+// one under path; false if it is missing or not one of ours
+// ---------------------------------------------------------------------------
+inline bool readDDS(const std::string& path, DDSImage& image)
+{
+    unsigned int magic = 0;
+    DDSHeader header;
+    const size_t headerSize = sizeof(magic) + sizeof(header);
+    AssetSpan asset = findAsset(path);
+    if (asset.data)
+    {
+        if (asset.size < headerSize)
+            return false;
+        memcpy(&magic, asset.data, sizeof(magic));
+        memcpy(&header, asset.data + sizeof(magic), sizeof(header));
+        size_t size = readDDSHeader(magic, header, image);
+        if (!size || size > asset.size - headerSize)
+            return false;
+        image.data.assign(asset.data + headerSize, asset.data + headerSize + size);
+        return true;
+    }
+
+    std::ifstream file(path.c_str(), std::ios::binary);
+    if (!file || !file.read((char*)&magic, sizeof(magic)) || !file.read((char*)&header, sizeof(header)))
+        return false;
+    size_t size = readDDSHeader(magic, header, image);
+    if (!size)
+        return false;
+    image.data.resize(size);
+    return (bool)file.read((char*)&image.data[0], image.data.size());
+}
+
+inline bool writeDDS(const std::string& path, const DDSImage& image)
+{
+    DDSHeader header;
+    memset(&header, 0, sizeof(header));
+    header.size = sizeof(DDSHeader);
+    header.flags = DDSD_CAPS | DDSD_HEIGHT | DDSD_WIDTH | DDSD_PIXELFORMAT | DDSD_MIPMAPCOUNT | DDSD_LINEARSIZE;
+    header.height = image.height;
+    header.width = image.width;
+    header.pitchOrLinearSize = (unsigned int)image.levels[0].size;
+    header.mipMapCount = (unsigned int)image.levels.size();
+    header.reserved1[0] = image.flipped ? DDS_FLIPPED : 0;
+    header.pixelFormat.size = sizeof(DDSPixelFormat);
+    header.pixelFormat.flags = DDPF_FOURCC;
+    header.pixelFormat.fourCC = image.fourCC;
+    header.caps = DDSCAPS_TEXTURE | (image.levels.size() > 1 ? DDSCAPS_COMPLEX | DDSCAPS_MIPMAP : 0);
+    if (image.faces == 6)
+    {
+        header.caps |= DDSCAPS_COMPLEX;
+        header.caps2 = DDSCAPS2_CUBEMAP | DDSCAPS2_CUBEMAP_ALLFACES;
+    }
+
+    std::ofstream file(path.c_str(), std::ios::binary);
+    file.write((const char*)&DDS_MAGIC, sizeof(DDS_MAGIC));
+    file.write((const char*)&header, sizeof(header));
+    file.write((const char*)&image.data[0], image.data.size());
+    return (bool)file;
+}
+
+#endif
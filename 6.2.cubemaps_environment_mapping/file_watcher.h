@@ -0,0 +1,140 @@
+#ifndef FILE_WATCHER_H
+#define FILE_WATCHER_H
+
+#include <iostream>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#if defined(__linux__)
+#include <dirent.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// reports files that were written in a set of watched directories. editors
+// often save by writing a temporary file and renaming it over the original,
+// so whole directories are watched and both plain writes and renames count.
+// poll() never blocks and is meant to be called once per frame.
+// only implemented with inotify on Linux; elsewhere nothing is ever reported.
+class FileWatcher
+{
+public:
+    FileWatcher() : descriptor(-1)
+    {
+    }
+
+    ~FileWatcher()
+    {
+        close();
+    }
+
+    // starts watching a directory, and with recursive every directory below it.
+    // reported paths are the directory as given here plus the file name, so
+    // they compare equal to the paths the files were loaded from; "." reports
+    // bare file names
+    // ------------------------------------------------------------------------
+    bool watch(const std::string& directory, bool recursive)
+    {
+#if defined(__linux__)
+        if (descriptor < 0)
+            descriptor = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (descriptor < 0)
+        {
+            std::cout << "Failed to initialize inotify" << std::endl;
+            return false;
+        }
+        unsigned int mask = IN_CLOSE_WRITE | IN_MOVED_TO | (recursive ? IN_CREATE : 0);
+        int watchID = inotify_add_watch(descriptor, directory.c_str(), mask);
+        if (watchID < 0)
+        {
+            std::cout << "Failed to watch directory: " << directory << std::endl;
+            return false;
+        }
+        Directory watched = { directory == "." ? std::string() : directory + "/", recursive };
+        directories[watchID] = watched;
+
+        if (recursive)
+        {
+            DIR* dir = opendir(directory.c_str());
+            if (!dir)
+                return true;
+            while (dirent* entry = readdir(dir))
+            {
+                std::string name = entry->d_name;
+                if (name == "." || name == "..")
+                    continue;
+                std::string path = watched.prefix + name;
+                struct stat info;
+                if (stat(path.c_str(), &info) == 0 && S_ISDIR(info.st_mode))
+                    watch(path, true);
+            }
+            closedir(dir);
+        }
+        return true;
+#else
+        (void)directory;
+        (void)recursive;
+        return false;
+#endif
+    }
+
+    // every file written since the last call, each reported once
+    // ------------------------------------------------------------------------
+    std::vector<std::string> poll()
+    {
+        std::set<std::string> changed;
+#if defined(__linux__)
+        if (descriptor < 0)
+            return std::vector<std::string>();
+        alignas(inotify_event) char buffer[4096];
+        for (;;)
+        {
+            ssize_t length = read(descriptor, buffer, sizeof(buffer));
+            if (length <= 0)
+                break; // EAGAIN: nothing more queued
+            for (char* next = buffer; next < buffer + length; next += sizeof(inotify_event) + ((inotify_event*)next)->len)
+            {
+                const inotify_event* event = (const inotify_event*)next;
+                std::map<int, Directory>::const_iterator it = directories.find(event->wd);
+                if (it == directories.end() || event->len == 0)
+                    continue;
+                std::string path = it->second.prefix + event->name;
+                if (event->mask & IN_ISDIR)
+                {
+                    // directories created later are watched too
+                    if ((event->mask & (IN_CREATE | IN_MOVED_TO)) && it->second.recursive)
+                        watch(path, true);
+                    continue;
+                }
+                if (event->mask & (IN_CLOSE_WRITE | IN_MOVED_TO))
+                    changed.insert(path);
+            }
+        }
+#endif
+        return std::vector<std::string>(changed.begin(), changed.end());
+    }
+
+    void close()
+    {
+#if defined(__linux__)
+        if (descriptor >= 0)
+            ::close(descriptor);
+#endif
+        descriptor = -1;
+        directories.clear();
+    }
+
+private:
+    struct Directory {
+        std::string prefix;
+        bool recursive;
+    };
+
+    int descriptor;
+    std::map<int, Directory> directories;
+};
+
+#endif
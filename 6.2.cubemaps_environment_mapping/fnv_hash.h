@@ -0,0 +1,19 @@
+#ifndef FNV_HASH_H
+#define FNV_HASH_H
+
+#include <cstddef>
+
+// 64-bit FNV-1a, used to fingerprint the benchmark's final image and to key
+// cached program binaries; pass the previous result as hash to chain buffers
+// ----------------------------------------------------------------------------
+inline unsigned long long fnv1a64(const unsigned char* data, size_t size, unsigned long long hash = 14695981039346656037ULL)
+{
+    for (size_t i = 0; i < size; ++i)
+    {
+        hash ^= data[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+#endif
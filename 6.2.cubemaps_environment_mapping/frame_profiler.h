@@ -0,0 +1,289 @@
+#ifndef FRAME_PROFILER_H
+#define FRAME_PROFILER_H
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+// the render stages we time separately
+enum RenderStage {
+    STAGE_GROUND,
+    STAGE_WALLS,
+    STAGE_CYLINDER,
+    STAGE_SPHERE,
+    STAGE_OCTAGON,
+    STAGE_INTERIOR,
+    STAGE_COLONNADE,
+    STAGE_SKYBOX,
+    STAGE_COUNT
+};
+
+inline const char* stageName(int stage)
+{
+    static const char* names[STAGE_COUNT] = { "ground", "walls", "cylinder", "sphere", "octagon", "interior", "colonnade", "skybox" };
+    return names[stage];
+}
+
+// the last WINDOW samples of one measurement
+class RollingSamples
+{
+public:
+    static const unsigned int WINDOW = 240;
+
+    RollingSamples() : next(0)
+    {
+    }
+
+    void add(double value)
+    {
+        if (samples.size() < WINDOW)
+            samples.push_back(value);
+        else
+            samples[next] = value;
+        next = (next + 1) % WINDOW;
+    }
+
+    bool empty() const
+    {
+        return samples.empty();
+    }
+
+    double min() const
+    {
+        return samples.empty() ? 0.0 : *std::min_element(samples.begin(), samples.end());
+    }
+
+    double average() const
+    {
+        double sum = 0.0;
+        for (double sample : samples)
+            sum += sample;
+        return samples.empty() ? 0.0 : sum / samples.size();
+    }
+
+    double percentile(double p) const
+    {
+        if (samples.empty())
+            return 0.0;
+        std::vector<double> sorted(samples);
+        size_t index = (size_t)(p * (sorted.size() - 1) + 0.5);
+        std::nth_element(sorted.begin(), sorted.begin() + index, sorted.end());
+        return sorted[index];
+    }
+
+private:
+    std::vector<double> samples;
+    unsigned int next;
+};
+
+// times every render stage on the CPU (steady_clock) and on the GPU
+// (GL_TIME_ELAPSED queries). GPU results are read back LATENCY frames
+// later and only when already available, so the profiler never stalls
+// the pipeline; only finish() waits, for the frames still in flight.
+// optionally writes one CSV row per resolved frame.
+class FrameProfiler
+{
+public:
+    static const unsigned int LATENCY = 4;
+
+    FrameProfiler() : enabled(false), frame(0), resolved(0)
+    {
+    }
+
+    // creates the query pool; csvPath may be NULL
+    // ------------------------------------------------------------------------
+    void init(const char* csvPath)
+    {
+        enabled = true;
+        glGenQueries(LATENCY * STAGE_COUNT, &queries[0][0]);
+        for (unsigned int slot = 0; slot < LATENCY; ++slot)
+            resetSlot(slot);
+        if (csvPath)
+        {
+            csv.open(csvPath);
+            csv << "frame,frame_cpu_ms";
+            for (int stage = 0; stage < STAGE_COUNT; ++stage)
+                csv << "," << stageName(stage) << "_cpu_ms," << stageName(stage) << "_gpu_ms";
+            csv << "\n";
+        }
+    }
+
+    bool isEnabled() const
+    {
+        return enabled;
+    }
+
+    // resolves the queries of the frame that used this slot LATENCY frames ago
+    // ------------------------------------------------------------------------
+    void beginFrame()
+    {
+        if (!enabled)
+            return;
+        unsigned int slot = frame % LATENCY;
+        if (frame >= LATENCY)
+            resolveSlot(slot, false);
+        resetSlot(slot);
+        slotFrame[slot] = frame;
+        frameStart = std::chrono::steady_clock::now();
+    }
+
+    void endFrame()
+    {
+        if (!enabled)
+            return;
+        unsigned int slot = frame % LATENCY;
+        frameCpu[slot] = millisecondsSince(frameStart);
+        frameTimes.add(frameCpu[slot]);
+        frame++;
+    }
+
+    void beginStage(int stage)
+    {
+        if (!enabled)
+            return;
+        unsigned int slot = frame % LATENCY;
+        glBeginQuery(GL_TIME_ELAPSED, queries[slot][stage]);
+        stageStart[stage] = std::chrono::steady_clock::now();
+    }
+
+    void endStage(int stage)
+    {
+        if (!enabled)
+            return;
+        unsigned int slot = frame % LATENCY;
+        glEndQuery(GL_TIME_ELAPSED);
+        double ms = millisecondsSince(stageStart[stage]);
+        cpu[slot][stage] = ms;
+        issued[slot][stage] = true;
+        cpuTimes[stage].add(ms);
+    }
+
+    // min / avg / p99 over the rolling window, in milliseconds
+    // ------------------------------------------------------------------------
+    void printSummary(std::ostream& out) const
+    {
+        if (!enabled)
+            return;
+        out << std::fixed << std::setprecision(3);
+        out << "frame    cpu min " << frameTimes.min() << " avg " << frameTimes.average() << " p99 " << frameTimes.percentile(0.99) << " ms" << std::endl;
+        for (int stage = 0; stage < STAGE_COUNT; ++stage)
+        {
+            if (cpuTimes[stage].empty())
+                continue;
+            out << std::left << std::setw(8) << stageName(stage) << std::right
+                << " cpu min " << cpuTimes[stage].min() << " avg " << cpuTimes[stage].average() << " p99 " << cpuTimes[stage].percentile(0.99)
+                << " | gpu min " << gpuTimes[stage].min() << " avg " << gpuTimes[stage].average() << " p99 " << gpuTimes[stage].percentile(0.99)
+                << " ms" << std::endl;
+        }
+        out.unsetf(std::ios::floatfield);
+    }
+
+    // resolves the last frames, which no later beginFrame() will, waiting for
+    // their queries. call it before the final printSummary()
+    // ------------------------------------------------------------------------
+    void finish()
+    {
+        if (!enabled)
+            return;
+        for (unsigned long long pending = resolved; pending < frame; ++pending)
+            resolveSlot(pending % LATENCY, true);
+    }
+
+    void release()
+    {
+        if (!enabled)
+            return;
+        finish();
+        glDeleteQueries(LATENCY * STAGE_COUNT, &queries[0][0]);
+        if (csv.is_open())
+            csv.close();
+        enabled = false;
+    }
+
+private:
+    bool enabled;
+    unsigned long long frame;
+    unsigned long long resolved; // every frame before this one has been resolved
+    unsigned int queries[LATENCY][STAGE_COUNT];
+    bool issued[LATENCY][STAGE_COUNT];
+    double cpu[LATENCY][STAGE_COUNT];
+    double frameCpu[LATENCY];
+    unsigned long long slotFrame[LATENCY];
+    std::chrono::steady_clock::time_point frameStart;
+    std::chrono::steady_clock::time_point stageStart[STAGE_COUNT];
+    RollingSamples frameTimes;
+    RollingSamples cpuTimes[STAGE_COUNT];
+    RollingSamples gpuTimes[STAGE_COUNT];
+    std::ofstream csv;
+
+    static double millisecondsSince(std::chrono::steady_clock::time_point start)
+    {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    void resetSlot(unsigned int slot)
+    {
+        for (int stage = 0; stage < STAGE_COUNT; ++stage)
+        {
+            issued[slot][stage] = false;
+            cpu[slot][stage] = 0.0;
+        }
+        frameCpu[slot] = 0.0;
+    }
+
+    // reads back whatever queries of the slot have finished; unless wait is
+    // set, results that are still pending are dropped instead of waited for
+    // ------------------------------------------------------------------------
+    void resolveSlot(unsigned int slot, bool wait)
+    {
+        double gpu[STAGE_COUNT];
+        for (int stage = 0; stage < STAGE_COUNT; ++stage)
+        {
+            gpu[stage] = -1.0;
+            if (!issued[slot][stage])
+                continue;
+            GLint available = 0;
+            glGetQueryObjectiv(queries[slot][stage], GL_QUERY_RESULT_AVAILABLE, &available);
+            if (!available && !wait)
+                continue;
+            GLuint64 elapsed = 0;
+            glGetQueryObjectui64v(queries[slot][stage], GL_QUERY_RESULT, &elapsed);
+            gpu[stage] = elapsed / 1000000.0;
+            gpuTimes[stage].add(gpu[stage]);
+        }
+        if (csv.is_open())
+        {
+            csv << slotFrame[slot] << "," << frameCpu[slot];
+            for (int stage = 0; stage < STAGE_COUNT; ++stage)
+                csv << "," << cpu[slot][stage] << "," << gpu[stage];
+            csv << "\n";
+        }
+        resolved = slotFrame[slot] + 1;
+    }
+};
+
+// times everything between construction and destruction as one stage
+class ScopedStageTimer
+{
+public:
+    ScopedStageTimer(FrameProfiler& profiler, int stage) : profiler(profiler), stage(stage)
+    {
+        profiler.beginStage(stage);
+    }
+
+    ~ScopedStageTimer()
+    {
+        profiler.endStage(stage);
+    }
+
+private:
+    FrameProfiler& profiler;
+    int stage;
+};
+
+#endif
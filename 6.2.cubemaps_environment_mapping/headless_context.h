@@ -0,0 +1,134 @@
+#ifndef HEADLESS_CONTEXT_H
+#define HEADLESS_CONTEXT_H
+
+#include <glad/glad.h>
+
+#include <iostream>
+#include <string>
+
+#if defined(__linux__)
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
+// an OpenGL 3.3 core context without a window, for benchmarking on machines
+// with no display. uses EGL with the Mesa surfaceless platform when it is
+// available (works on llvmpipe without a GPU) and a 1x1 pbuffer otherwise.
+class HeadlessContext
+{
+public:
+#if defined(__linux__)
+    HeadlessContext() : display(EGL_NO_DISPLAY), surface(EGL_NO_SURFACE), context(EGL_NO_CONTEXT)
+    {
+    }
+
+    // creates the context, makes it current and loads the GL functions
+    // ------------------------------------------------------------------------
+    bool create()
+    {
+        PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay =
+            (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+#ifdef EGL_PLATFORM_SURFACELESS_MESA
+        if (getPlatformDisplay)
+            display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+#endif
+        if (display == EGL_NO_DISPLAY)
+            display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+        EGLint major, minor;
+        if (display == EGL_NO_DISPLAY || !eglInitialize(display, &major, &minor))
+        {
+            std::cout << "Failed to initialize EGL" << std::endl;
+            return false;
+        }
+        eglBindAPI(EGL_OPENGL_API);
+
+        const EGLint configAttributes[] = {
+            EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+            EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+            EGL_RED_SIZE, 8, EGL_GREEN_SIZE, 8, EGL_BLUE_SIZE, 8, EGL_ALPHA_SIZE, 8,
+            EGL_DEPTH_SIZE, 24,
+            EGL_NONE
+        };
+        EGLConfig config = NULL;
+        EGLint configCount = 0;
+        eglChooseConfig(display, configAttributes, &config, 1, &configCount);
+        if (configCount == 0)
+        {
+            // surfaceless displays may not advertise pbuffer configs
+            const EGLint anyConfig[] = { EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_NONE };
+            eglChooseConfig(display, anyConfig, &config, 1, &configCount);
+        }
+
+        const EGLint contextAttributes[] = {
+            EGL_CONTEXT_MAJOR_VERSION, 3,
+            EGL_CONTEXT_MINOR_VERSION, 3,
+            EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+            EGL_NONE
+        };
+        context = eglCreateContext(display, configCount ? config : EGL_NO_CONFIG_KHR, EGL_NO_CONTEXT, contextAttributes);
+        if (context == EGL_NO_CONTEXT)
+        {
+            std::cout << "Failed to create EGL context" << std::endl;
+            release();
+            return false;
+        }
+
+        // we render into our own framebuffer, the surface is only there to
+        // satisfy implementations without EGL_KHR_surfaceless_context
+        const char* extensions = eglQueryString(display, EGL_EXTENSIONS);
+        bool surfaceless = extensions && std::string(extensions).find("EGL_KHR_surfaceless_context") != std::string::npos;
+        if (!surfaceless && configCount)
+        {
+            const EGLint pbufferAttributes[] = { EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE };
+            surface = eglCreatePbufferSurface(display, config, pbufferAttributes);
+        }
+        if (!eglMakeCurrent(display, surface, surface, context))
+        {
+            std::cout << "Failed to make the EGL context current" << std::endl;
+            release();
+            return false;
+        }
+
+        if (!gladLoadGLLoader((GLADloadproc)eglGetProcAddress))
+        {
+            std::cout << "Failed to initialize GLAD" << std::endl;
+            release();
+            return false;
+        }
+        std::cout << "headless context: " << glGetString(GL_RENDERER) << ", " << glGetString(GL_VERSION) << std::endl;
+        return true;
+    }
+
+    void release()
+    {
+        if (display == EGL_NO_DISPLAY)
+            return;
+        eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+        if (context != EGL_NO_CONTEXT)
+            eglDestroyContext(display, context);
+        if (surface != EGL_NO_SURFACE)
+            eglDestroySurface(display, surface);
+        eglTerminate(display);
+        display = EGL_NO_DISPLAY;
+        surface = EGL_NO_SURFACE;
+        context = EGL_NO_CONTEXT;
+    }
+
+private:
+    EGLDisplay display;
+    EGLSurface surface;
+    EGLContext context;
+#else
+    bool create()
+    {
+        std::cout << "Headless benchmarking needs EGL and is only available on Linux" << std::endl;
+        return false;
+    }
+
+    void release()
+    {
+    }
+#endif
+};
+
+#endif
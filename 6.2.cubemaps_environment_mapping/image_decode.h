@@ -0,0 +1,157 @@
+#ifndef IMAGE_DECODE_H
+#define IMAGE_DECODE_H
+
+#include <stb_image.h>
+
+#include "asset_bundle.h"
+#include "image_kernels.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// an image decoded by stb_image; data is NULL if the decode failed
+struct DecodedImage {
+    std::string path;
+    unsigned char* data;
+    int width;
+    int height;
+    int channels;
+    std::vector<MipLevel> mips; // levels 1..n when built on the CPU, see decodeTexture()
+};
+
+// mirrors the rows in place
+// -------------------------
+inline void flipRows(unsigned char* data, int width, int height, int channels)
+{
+    size_t stride = (size_t)width * channels;
+    std::vector<unsigned char> row(stride);
+    for (int top = 0, bottom = height - 1; top < bottom; ++top, --bottom)
+    {
+        memcpy(&row[0], data + top * stride, stride);
+        memcpy(data + top * stride, data + bottom * stride, stride);
+        memcpy(data + bottom * stride, &row[0], stride);
+    }
+}
+
+// resizes an 8-bit image with bilinear filtering
+// ---------------------------------------------
+inline void resizeBilinear(const unsigned char* src, int srcWidth, int srcHeight,
+                           unsigned char* dst, int dstWidth, int dstHeight, int channels)
+{
+    for (int y = 0; y < dstHeight; ++y)
+    {
+        float sy = ((y + 0.5f) * srcHeight) / dstHeight - 0.5f;
+        if (sy < 0.0f) sy = 0.0f;
+        int y0 = (int)sy;
+        int y1 = y0 + 1 < srcHeight ? y0 + 1 : y0;
+        float fy = sy - y0;
+        for (int x = 0; x < dstWidth; ++x)
+        {
+            float sx = ((x + 0.5f) * srcWidth) / dstWidth - 0.5f;
+            if (sx < 0.0f) sx = 0.0f;
+            int x0 = (int)sx;
+            int x1 = x0 + 1 < srcWidth ? x0 + 1 : x0;
+            float fx = sx - x0;
+            for (int c = 0; c < channels; ++c)
+            {
+                float top = src[(y0 * srcWidth + x0) * channels + c] * (1.0f - fx) + src[(y0 * srcWidth + x1) * channels + c] * fx;
+                float bottom = src[(y1 * srcWidth + x0) * channels + c] * (1.0f - fx) + src[(y1 * srcWidth + x1) * channels + c] * fx;
+                dst[(y * dstWidth + x) * channels + c] = (unsigned char)(top * (1.0f - fy) + bottom * fy + 0.5f);
+            }
+        }
+    }
+}
+
+// stb_image on the file at path, or on its bytes in the mounted asset bundle
+// ---------------------------------------------------------------------------
+inline unsigned char* loadImagePixels(const std::string& path, int* width, int* height, int* channels, int desiredChannels)
+{
+    AssetSpan asset = findAsset(path);
+    if (asset.data)
+        return stbi_load_from_memory(asset.data, (int)asset.size, width, height, channels, desiredChannels);
+    return stbi_load(path.c_str(), width, height, channels, desiredChannels);
+}
+
+// decodes an image file; safe to call from worker threads. the flip is done
+// here instead of through stbi_set_flip_vertically_on_load, which is a global
+// switch shared by every thread. desiredChannels 0 keeps the file's channels.
+// ---------------------------------------------------------------------------
+inline DecodedImage decodeImage(const std::string& path, int desiredChannels, bool flip)
+{
+    DecodedImage image;
+    image.path = path;
+    int fileChannels = 0;
+    image.data = loadImagePixels(path, &image.width, &image.height, &fileChannels, desiredChannels == 4 ? 0 : desiredChannels);
+    image.channels = desiredChannels ? desiredChannels : fileChannels;
+    if (image.data && desiredChannels == 4 && fileChannels == 3)
+    {
+        // RGB files (every JPEG) are expanded by the vector kernel instead of
+        // stb_image's per pixel loop. the new buffer comes from malloc like
+        // stb_image's own, so freeImage() releases either
+        size_t pixels = (size_t)image.width * image.height;
+        unsigned char* rgba = (unsigned char*)std::malloc(pixels * 4);
+        if (rgba)
+            expandRGBToRGBA(image.data, rgba, pixels);
+        stbi_image_free(image.data);
+        image.data = rgba;
+    }
+    else if (image.data && desiredChannels == 4 && fileChannels != 4)
+    {
+        // gray images are rare enough to let stb_image convert them
+        stbi_image_free(image.data);
+        image.data = loadImagePixels(path, &image.width, &image.height, &fileChannels, 4);
+    }
+    if (image.data && flip)
+        flipRows(image.data, image.width, image.height, image.channels);
+    return image;
+}
+
+// whether decodeTexture() premultiplies color by alpha; off by default as the
+// shaders draw without blending, where premultiplied texels look darker
+// ---------------------------------------------------------------------------
+inline bool& premultiplyAlphaOnLoad()
+{
+    static bool enabled = false;
+    return enabled;
+}
+
+// decodes an image for a mipmapped 2D texture: always RGBA, so every row of
+// every level is four byte aligned, optionally premultiplied, with the mip
+// chain built here in linear light instead of by glGenerateMipmap on the GL
+// thread. a non-zero width and height resize the image to that size first,
+// e.g. for a texture array layer. safe to call from worker threads like
+// decodeImage()
+// ---------------------------------------------------------------------------
+inline DecodedImage decodeTexture(const std::string& path, bool flip, int width = 0, int height = 0)
+{
+    DecodedImage image = decodeImage(path, 4, flip);
+    if (!image.data)
+        return image;
+    if (premultiplyAlphaOnLoad())
+        premultiplyAlpha(image.data, (size_t)image.width * image.height);
+    if (width > 0 && height > 0 && (image.width != width || image.height != height))
+    {
+        unsigned char* resized = (unsigned char*)std::malloc((size_t)width * height * 4);
+        if (resized)
+            resizeBilinear(image.data, image.width, image.height, resized, width, height, 4);
+        stbi_image_free(image.data);
+        image.data = resized;
+        image.width = width;
+        image.height = height;
+        if (!image.data)
+            return image;
+    }
+    image.mips = buildMipChain(image.data, image.width, image.height);
+    return image;
+}
+
+inline void freeImage(DecodedImage& image)
+{
+    stbi_image_free(image.data);
+    image.data = NULL;
+    image.mips.clear();
+}
+
+#endif
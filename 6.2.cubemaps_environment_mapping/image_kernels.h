@@ -0,0 +1,352 @@
+#ifndef IMAGE_KERNELS_H
+#define IMAGE_KERNELS_H
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSSE3__)
+#include <tmmintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#endif
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#endif
+
+// pixel conversions of the texture load path, each with a scalar reference
+// version (the *Scalar functions) and a vector version picked at compile
+// time: AVX2, SSE2 (SSSE3 for the byte shuffle) or NEON. the two always
+// produce identical bytes; image_kernels_bench checks that and compares
+// their throughput. every image is tightly packed, RGBA unless noted.
+#if defined(__AVX2__)
+#define IMAGE_KERNELS_AVX2
+#endif
+#if defined(__SSSE3__) || defined(__AVX2__)
+#define IMAGE_KERNELS_SSSE3
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define IMAGE_KERNELS_SSE2
+#endif
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define IMAGE_KERNELS_NEON
+#endif
+
+// the widest instruction set the vector versions were compiled for
+inline const char* imageKernelsInstructionSet()
+{
+#if defined(IMAGE_KERNELS_AVX2)
+    return "AVX2";
+#elif defined(IMAGE_KERNELS_SSSE3)
+    return "SSSE3";
+#elif defined(IMAGE_KERNELS_SSE2)
+    return "SSE2";
+#elif defined(IMAGE_KERNELS_NEON)
+    return "NEON";
+#else
+    return "scalar";
+#endif
+}
+
+// RGB -> RGBA with opaque alpha, so uploads are four byte aligned
+// ---------------------------------------------------------------
+inline void expandRGBToRGBAScalar(const unsigned char* rgb, unsigned char* rgba, size_t pixels, size_t first = 0)
+{
+    for (size_t i = first; i < pixels; ++i)
+    {
+        rgba[i * 4 + 0] = rgb[i * 3 + 0];
+        rgba[i * 4 + 1] = rgb[i * 3 + 1];
+        rgba[i * 4 + 2] = rgb[i * 3 + 2];
+        rgba[i * 4 + 3] = 255;
+    }
+}
+
+inline void expandRGBToRGBA(const unsigned char* rgb, unsigned char* rgba, size_t pixels)
+{
+    size_t i = 0;
+#if defined(IMAGE_KERNELS_SSSE3)
+    // four pixels per 16 byte load; the load reads 4 bytes past the pixels it
+    // uses, so stop while at least 6 pixels are left
+    const __m128i spread = _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+    const __m128i opaque = _mm_set1_epi32((int)0xFF000000);
+#if defined(IMAGE_KERNELS_AVX2)
+    const __m256i spread2 = _mm256_broadcastsi128_si256(spread);
+    const __m256i opaque2 = _mm256_set1_epi32((int)0xFF000000);
+    for (; i + 10 <= pixels; i += 8)
+    {
+        __m128i low = _mm_loadu_si128((const __m128i*)(rgb + i * 3));
+        __m128i high = _mm_loadu_si128((const __m128i*)(rgb + i * 3 + 12));
+        __m256i both = _mm256_inserti128_si256(_mm256_castsi128_si256(low), high, 1);
+        _mm256_storeu_si256((__m256i*)(rgba + i * 4), _mm256_or_si256(_mm256_shuffle_epi8(both, spread2), opaque2));
+    }
+#endif
+    for (; i + 6 <= pixels; i += 4)
+    {
+        __m128i source = _mm_loadu_si128((const __m128i*)(rgb + i * 3));
+        _mm_storeu_si128((__m128i*)(rgba + i * 4), _mm_or_si128(_mm_shuffle_epi8(source, spread), opaque));
+    }
+#elif defined(IMAGE_KERNELS_NEON)
+    for (; i + 16 <= pixels; i += 16)
+    {
+        uint8x16x3_t source = vld3q_u8(rgb + i * 3);
+        uint8x16x4_t result;
+        result.val[0] = source.val[0];
+        result.val[1] = source.val[1];
+        result.val[2] = source.val[2];
+        result.val[3] = vdupq_n_u8(255);
+        vst4q_u8(rgba + i * 4, result);
+    }
+#endif
+    expandRGBToRGBAScalar(rgb, rgba, pixels, i);
+}
+
+// multiplies the color channels by alpha, round(c * a / 255), so filtering
+// and mip generation no longer bleed the color of see-through texels
+// ---------------------------------------------------------------------------
+inline void premultiplyAlphaScalar(unsigned char* rgba, size_t pixels, size_t first = 0)
+{
+    for (size_t i = first; i < pixels; ++i)
+    {
+        unsigned int alpha = rgba[i * 4 + 3];
+        for (int c = 0; c < 3; ++c)
+        {
+            unsigned int t = rgba[i * 4 + c] * alpha + 128;
+            rgba[i * 4 + c] = (unsigned char)((t + (t >> 8)) >> 8);
+        }
+    }
+}
+
+inline void premultiplyAlpha(unsigned char* rgba, size_t pixels)
+{
+    size_t i = 0;
+#if defined(IMAGE_KERNELS_AVX2)
+    const __m256i zero2 = _mm256_setzero_si256();
+    const __m256i colorLanes2 = _mm256_setr_epi16(-1, -1, -1, 0, -1, -1, -1, 0, -1, -1, -1, 0, -1, -1, -1, 0);
+    const __m256i alphaLane2 = _mm256_setr_epi16(0, 0, 0, 255, 0, 0, 0, 255, 0, 0, 0, 255, 0, 0, 0, 255);
+    const __m256i half2 = _mm256_set1_epi16(128);
+    for (; i + 8 <= pixels; i += 8)
+    {
+        __m256i source = _mm256_loadu_si256((const __m256i*)(rgba + i * 4));
+        __m256i halves[2] = { _mm256_unpacklo_epi8(source, zero2), _mm256_unpackhi_epi8(source, zero2) };
+        for (__m256i& x : halves)
+        {
+            // alpha in the color lanes, 255 in the alpha lane so alpha stays as it is
+            __m256i alpha = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(x, 0xFF), 0xFF);
+            __m256i factor = _mm256_or_si256(_mm256_and_si256(alpha, colorLanes2), alphaLane2);
+            __m256i t = _mm256_add_epi16(_mm256_mullo_epi16(x, factor), half2);
+            x = _mm256_srli_epi16(_mm256_add_epi16(t, _mm256_srli_epi16(t, 8)), 8);
+        }
+        _mm256_storeu_si256((__m256i*)(rgba + i * 4), _mm256_packus_epi16(halves[0], halves[1]));
+    }
+#endif
+#if defined(IMAGE_KERNELS_SSE2)
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i colorLanes = _mm_setr_epi16(-1, -1, -1, 0, -1, -1, -1, 0);
+    const __m128i alphaLane = _mm_setr_epi16(0, 0, 0, 255, 0, 0, 0, 255);
+    const __m128i half = _mm_set1_epi16(128);
+    for (; i + 4 <= pixels; i += 4)
+    {
+        __m128i source = _mm_loadu_si128((const __m128i*)(rgba + i * 4));
+        __m128i halves[2] = { _mm_unpacklo_epi8(source, zero), _mm_unpackhi_epi8(source, zero) };
+        for (__m128i& x : halves)
+        {
+            __m128i alpha = _mm_shufflehi_epi16(_mm_shufflelo_epi16(x, 0xFF), 0xFF);
+            __m128i factor = _mm_or_si128(_mm_and_si128(alpha, colorLanes), alphaLane);
+            __m128i t = _mm_add_epi16(_mm_mullo_epi16(x, factor), half);
+            x = _mm_srli_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), 8);
+        }
+        _mm_storeu_si128((__m128i*)(rgba + i * 4), _mm_packus_epi16(halves[0], halves[1]));
+    }
+#elif defined(IMAGE_KERNELS_NEON)
+    for (; i + 16 <= pixels; i += 16)
+    {
+        uint8x16x4_t x = vld4q_u8(rgba + i * 4);
+        for (int c = 0; c < 3; ++c)
+        {
+            // (p + ((p + 128) >> 8) + 128) >> 8 is the same rounding as above
+            uint16x8_t low = vmull_u8(vget_low_u8(x.val[c]), vget_low_u8(x.val[3]));
+            uint16x8_t high = vmull_u8(vget_high_u8(x.val[c]), vget_high_u8(x.val[3]));
+            x.val[c] = vcombine_u8(vraddhn_u16(low, vrshrq_n_u16(low, 8)), vraddhn_u16(high, vrshrq_n_u16(high, 8)));
+        }
+        vst4q_u8(rgba + i * 4, x);
+    }
+#endif
+    premultiplyAlphaScalar(rgba, pixels, i);
+}
+
+// sRGB <-> linear light. a table lookup per value is already the fastest way
+// to do these on every target (vector gathers don't beat it), so they have a
+// single version. linear values are 16-bit fixed point, enough to make the
+// round trip of every 8-bit value exact
+// ---------------------------------------------------------------------------
+inline const uint16_t* srgbToLinearTable()
+{
+    static const std::vector<uint16_t> table = []() {
+        std::vector<uint16_t> values(256);
+        for (int i = 0; i < 256; ++i)
+        {
+            double c = i / 255.0;
+            double linear = c <= 0.04045 ? c / 12.92 : std::pow((c + 0.055) / 1.055, 2.4);
+            values[i] = (uint16_t)(linear * 65535.0 + 0.5);
+        }
+        return values;
+    }();
+    return &table[0];
+}
+
+inline const unsigned char* linearToSrgbTable()
+{
+    static const std::vector<unsigned char> table = []() {
+        std::vector<unsigned char> values(65536);
+        for (int i = 0; i < 65536; ++i)
+        {
+            double linear = i / 65535.0;
+            double c = linear <= 0.0031308 ? linear * 12.92 : 1.055 * std::pow(linear, 1.0 / 2.4) - 0.055;
+            values[i] = (unsigned char)(c * 255.0 + 0.5);
+        }
+        return values;
+    }();
+    return &table[0];
+}
+
+// RGBA8 with sRGB color -> RGBA16 in linear light; alpha is linear already
+inline void srgbToLinear(const unsigned char* rgba, uint16_t* linear, size_t pixels)
+{
+    const uint16_t* table = srgbToLinearTable();
+    for (size_t i = 0; i < pixels * 4; i += 4)
+    {
+        linear[i + 0] = table[rgba[i + 0]];
+        linear[i + 1] = table[rgba[i + 1]];
+        linear[i + 2] = table[rgba[i + 2]];
+        linear[i + 3] = (uint16_t)(rgba[i + 3] * 257);
+    }
+}
+
+inline void linearToSrgb(const uint16_t* linear, unsigned char* rgba, size_t pixels)
+{
+    const unsigned char* table = linearToSrgbTable();
+    for (size_t i = 0; i < pixels * 4; i += 4)
+    {
+        rgba[i + 0] = table[linear[i + 0]];
+        rgba[i + 1] = table[linear[i + 1]];
+        rgba[i + 2] = table[linear[i + 2]];
+        rgba[i + 3] = (unsigned char)((linear[i + 3] + 128) / 257);
+    }
+}
+
+// halves an RGBA16 image with a 2x2 box filter; odd edges repeat the last
+// row / column. each output is avg(avg(top left, bottom left),
+// avg(top right, bottom right)) with round-half-up averages, which is what
+// the vector average instructions compute
+// ------------------------------------------------------------------------
+inline void downsample2x2Row(const uint16_t* top, const uint16_t* bottom, int width, uint16_t* out, int outWidth, int first)
+{
+    for (int x = first; x < outWidth; ++x)
+    {
+        int left = 2 * x;
+        int right = left + 1 < width ? left + 1 : left;
+        for (int c = 0; c < 4; ++c)
+        {
+            unsigned int a = (top[left * 4 + c] + bottom[left * 4 + c] + 1) >> 1;
+            unsigned int b = (top[right * 4 + c] + bottom[right * 4 + c] + 1) >> 1;
+            out[x * 4 + c] = (uint16_t)((a + b + 1) >> 1);
+        }
+    }
+}
+
+inline void downsample2x2Scalar(const uint16_t* source, int width, int height, uint16_t* target)
+{
+    int outWidth = width > 1 ? width / 2 : 1;
+    int outHeight = height > 1 ? height / 2 : 1;
+    for (int y = 0; y < outHeight; ++y)
+    {
+        const uint16_t* top = source + (size_t)(2 * y) * width * 4;
+        const uint16_t* bottom = 2 * y + 1 < height ? top + (size_t)width * 4 : top;
+        downsample2x2Row(top, bottom, width, target + (size_t)y * outWidth * 4, outWidth, 0);
+    }
+}
+
+inline void downsample2x2(const uint16_t* source, int width, int height, uint16_t* target)
+{
+    int outWidth = width > 1 ? width / 2 : 1;
+    int outHeight = height > 1 ? height / 2 : 1;
+    for (int y = 0; y < outHeight; ++y)
+    {
+        const uint16_t* top = source + (size_t)(2 * y) * width * 4;
+        const uint16_t* bottom = 2 * y + 1 < height ? top + (size_t)width * 4 : top;
+        uint16_t* out = target + (size_t)y * outWidth * 4;
+        int x = 0;
+        if (width > 1)
+        {
+#if defined(IMAGE_KERNELS_AVX2)
+            // 8 source pixels -> 4 outputs
+            for (; x + 4 <= outWidth; x += 4)
+            {
+                __m256i a = _mm256_avg_epu16(_mm256_loadu_si256((const __m256i*)(top + x * 8)), _mm256_loadu_si256((const __m256i*)(bottom + x * 8)));
+                __m256i b = _mm256_avg_epu16(_mm256_loadu_si256((const __m256i*)(top + x * 8 + 16)), _mm256_loadu_si256((const __m256i*)(bottom + x * 8 + 16)));
+                __m256i sum = _mm256_avg_epu16(_mm256_unpacklo_epi64(a, b), _mm256_unpackhi_epi64(a, b));
+                _mm256_storeu_si256((__m256i*)(out + x * 4), _mm256_permute4x64_epi64(sum, 0xD8));
+            }
+#endif
+#if defined(IMAGE_KERNELS_SSE2)
+            // 4 source pixels -> 2 outputs
+            for (; x + 2 <= outWidth; x += 2)
+            {
+                __m128i a = _mm_avg_epu16(_mm_loadu_si128((const __m128i*)(top + x * 8)), _mm_loadu_si128((const __m128i*)(bottom + x * 8)));
+                __m128i b = _mm_avg_epu16(_mm_loadu_si128((const __m128i*)(top + x * 8 + 8)), _mm_loadu_si128((const __m128i*)(bottom + x * 8 + 8)));
+                _mm_storeu_si128((__m128i*)(out + x * 4), _mm_avg_epu16(_mm_unpacklo_epi64(a, b), _mm_unpackhi_epi64(a, b)));
+            }
+#elif defined(IMAGE_KERNELS_NEON)
+            for (; x + 2 <= outWidth; x += 2)
+            {
+                uint16x8_t a = vrhaddq_u16(vld1q_u16(top + x * 8), vld1q_u16(bottom + x * 8));
+                uint16x8_t b = vrhaddq_u16(vld1q_u16(top + x * 8 + 8), vld1q_u16(bottom + x * 8 + 8));
+                uint16x8_t lefts = vcombine_u16(vget_low_u16(a), vget_low_u16(b));
+                uint16x8_t rights = vcombine_u16(vget_high_u16(a), vget_high_u16(b));
+                vst1q_u16(out + x * 4, vrhaddq_u16(lefts, rights));
+            }
+#endif
+        }
+        downsample2x2Row(top, bottom, width, out, outWidth, x);
+    }
+}
+
+// one level of a mip chain built on the CPU
+struct MipLevel {
+    int width;
+    int height;
+    std::vector<unsigned char> data; // RGBA8
+};
+
+// levels 1..n of an RGBA8 sRGB image down to 1x1, filtered in linear light
+// so the smaller levels keep the brightness of the full image
+// ---------------------------------------------------------------------------
+inline std::vector<MipLevel> buildMipChain(const unsigned char* rgba, int width, int height)
+{
+    std::vector<MipLevel> levels;
+    std::vector<uint16_t> current((size_t)width * height * 4);
+    srgbToLinear(rgba, &current[0], (size_t)width * height);
+    std::vector<uint16_t> next;
+    while (width > 1 || height > 1)
+    {
+        int nextWidth = width > 1 ? width / 2 : 1;
+        int nextHeight = height > 1 ? height / 2 : 1;
+        next.resize((size_t)nextWidth * nextHeight * 4);
+        downsample2x2(&current[0], width, height, &next[0]);
+        MipLevel level;
+        level.width = nextWidth;
+        level.height = nextHeight;
+        level.data.resize(next.size());
+        linearToSrgb(&next[0], &level.data[0], (size_t)nextWidth * nextHeight);
+        levels.push_back(level);
+        current.swap(next);
+        width = nextWidth;
+        height = nextHeight;
+    }
+    return levels;
+}
+
+#endif
@@ -0,0 +1,183 @@
+// throughput of the image kernels (image_kernels.h) that the texture load path
+// runs on every decoded image: each vector version against its scalar
+// reference, on the same pixels. also checks that both produce the same bytes
+// and that sRGB -> linear -> sRGB returns every 8-bit value unchanged. given
+// an image file it also times decodeImage() against the stb_image path it
+// replaced (stbi_load with 4 channels) and checks they decode the same bytes.
+//
+// usage: image_kernels_bench [image] [--size <pixels>] [--runs <n>]
+//   image          time on the pixels of this file instead of random noise
+//   --size <n>     width and height of the noise image (default 2048)
+//   --runs <n>     repetitions per kernel, the fastest one counts (default 10)
+//
+// it is its own executable next to the chapter, linked against stb_image
+// only. build it with the flags of the renderer to measure what it runs,
+// e.g. for AVX2
+//   g++ -std=c++17 -O2 -mavx2 -I<includes> image_kernels_bench.cpp stb_image.cpp -o image_kernels_bench
+#include <stb_image.h>
+
+#include "image_decode.h"
+#include "image_kernels.h"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+// fastest of runs calls, in seconds
+// ---------------------------------
+double fastest(int runs, const std::function<void()>& kernel)
+{
+    double best = 1e30;
+    for (int i = 0; i < runs; ++i)
+    {
+        std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+        kernel();
+        double seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+        if (seconds < best)
+            best = seconds;
+    }
+    return best;
+}
+
+// prints one row: MB/s of input for both versions and whether they agree
+// ------------------------------------------------------------------------
+void report(const char* name, size_t bytes, double scalar, double vector, bool same)
+{
+    std::cout << std::left << std::setw(22) << name << std::right << std::fixed << std::setprecision(0)
+              << std::setw(10) << bytes / scalar / 1e6 << " MB/s" << std::setw(10) << bytes / vector / 1e6 << " MB/s"
+              << std::setprecision(2) << std::setw(8) << scalar / vector << "x" << (same ? "" : "   MISMATCH") << std::endl;
+    std::cout.unsetf(std::ios::floatfield);
+}
+
+int main(int argc, char* argv[])
+{
+    std::string path;
+    int size = 2048;
+    int runs = 10;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg == "--size" && i + 1 < argc)
+            size = std::atoi(argv[++i]);
+        else if (arg == "--runs" && i + 1 < argc)
+            runs = std::atoi(argv[++i]);
+        else
+            path = arg;
+    }
+
+    // the source pixels, RGBA with a varied alpha channel
+    int width = size, height = size;
+    std::vector<unsigned char> rgba;
+    bool allSame = true;
+    if (!path.empty())
+    {
+        // the whole decode against the old stb_image conversion to RGBA
+        size_t fileBytes = 0;
+        double old = fastest(runs, [&]() {
+            int w = 0, h = 0, channels = 0;
+            unsigned char* pixels = stbi_load(path.c_str(), &w, &h, &channels, 4);
+            fileBytes = (size_t)w * h * 4;
+            stbi_image_free(pixels);
+        });
+        double current = fastest(runs, [&]() {
+            DecodedImage image = decodeImage(path, 4, false);
+            freeImage(image);
+        });
+        int w = 0, h = 0, channels = 0;
+        unsigned char* reference = stbi_load(path.c_str(), &w, &h, &channels, 4);
+        DecodedImage decoded = decodeImage(path, 4, false);
+        bool decodedSame = reference && decoded.data && decoded.width == w && decoded.height == h && memcmp(reference, decoded.data, (size_t)w * h * 4) == 0;
+        stbi_image_free(reference);
+        freeImage(decoded);
+        std::cout << std::left << std::setw(22) << "decode" << std::right << std::setw(15) << "stbi_load" << std::setw(15) << "decodeImage" << std::endl;
+        report("decode to RGBA", fileBytes, old, current, decodedSame);
+        allSame = allSame && decodedSame;
+
+        DecodedImage image = decodeImage(path, 4, false);
+        if (!image.data)
+        {
+            std::cout << "Failed to load " << path << std::endl;
+            return 1;
+        }
+        width = image.width;
+        height = image.height;
+        rgba.assign(image.data, image.data + (size_t)width * height * 4);
+        freeImage(image);
+    }
+    else
+    {
+        std::mt19937 random(1);
+        rgba.resize((size_t)width * height * 4);
+        for (unsigned char& value : rgba)
+            value = (unsigned char)random();
+    }
+    size_t pixels = (size_t)width * height;
+    std::vector<unsigned char> rgb(pixels * 3);
+    for (size_t i = 0; i < pixels; ++i)
+        memcpy(&rgb[i * 3], &rgba[i * 4], 3);
+
+    std::cout << width << "x" << height << ", vector kernels built for " << imageKernelsInstructionSet() << std::endl;
+    std::cout << std::left << std::setw(22) << "kernel" << std::right << std::setw(15) << "scalar" << std::setw(15) << "vector" << std::endl;
+
+    // RGB -> RGBA
+    std::vector<unsigned char> expandedScalar(pixels * 4), expanded(pixels * 4);
+    double scalar = fastest(runs, [&]() { expandRGBToRGBAScalar(&rgb[0], &expandedScalar[0], pixels); });
+    double vector = fastest(runs, [&]() { expandRGBToRGBA(&rgb[0], &expanded[0], pixels); });
+    bool same = expanded == expandedScalar;
+    report("expand RGB -> RGBA", rgb.size(), scalar, vector, same);
+    allSame = allSame && same;
+
+    // premultiply, on a fresh copy every run
+    std::vector<unsigned char> premultipliedScalar, premultiplied;
+    scalar = fastest(runs, [&]() { premultipliedScalar = rgba; premultiplyAlphaScalar(&premultipliedScalar[0], pixels); });
+    vector = fastest(runs, [&]() { premultiplied = rgba; premultiplyAlpha(&premultiplied[0], pixels); });
+    same = premultiplied == premultipliedScalar;
+    report("premultiply alpha", rgba.size(), scalar, vector, same);
+    allSame = allSame && same;
+
+    // 2x2 box filter in linear light
+    std::vector<uint16_t> linear(pixels * 4);
+    srgbToLinear(&rgba[0], &linear[0], pixels);
+    int halfWidth = width > 1 ? width / 2 : 1, halfHeight = height > 1 ? height / 2 : 1;
+    std::vector<uint16_t> halfScalar((size_t)halfWidth * halfHeight * 4), half(halfScalar.size());
+    scalar = fastest(runs, [&]() { downsample2x2Scalar(&linear[0], width, height, &halfScalar[0]); });
+    vector = fastest(runs, [&]() { downsample2x2(&linear[0], width, height, &half[0]); });
+    same = half == halfScalar;
+    report("downsample 2x2", linear.size() * 2, scalar, vector, same);
+    allSame = allSame && same;
+
+    // the table conversions and the whole chain have one version each
+    std::vector<unsigned char> encoded(pixels * 4);
+    double decode = fastest(runs, [&]() { srgbToLinear(&rgba[0], &linear[0], pixels); });
+    double encode = fastest(runs, [&]() { linearToSrgb(&linear[0], &encoded[0], pixels); });
+    double chain = fastest(runs, [&]() { buildMipChain(&rgba[0], width, height); });
+    std::cout << std::fixed << std::setprecision(0)
+              << "sRGB -> linear        " << rgba.size() / decode / 1e6 << " MB/s" << std::endl
+              << "linear -> sRGB        " << rgba.size() / encode / 1e6 << " MB/s" << std::endl
+              << "mip chain             " << rgba.size() / chain / 1e6 << " MB/s" << std::endl;
+    std::cout.unsetf(std::ios::floatfield);
+
+    // every 8-bit value survives the round trip through linear light
+    for (int value = 0; value < 256; ++value)
+    {
+        unsigned char in[4] = { (unsigned char)value, (unsigned char)value, (unsigned char)value, (unsigned char)value };
+        uint16_t light[4];
+        unsigned char out[4];
+        srgbToLinear(in, light, 1);
+        linearToSrgb(light, out, 1);
+        if (memcmp(in, out, 4) != 0)
+        {
+            std::cout << "sRGB round trip changes " << value << " into " << (int)out[0] << std::endl;
+            allSame = false;
+        }
+    }
+
+    return allSame ? 0 : 1;
+}
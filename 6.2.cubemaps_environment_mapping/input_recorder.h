@@ -0,0 +1,231 @@
+#ifndef INPUT_RECORDER_H
+#define INPUT_RECORDER_H
+
+#include <glm/glm.hpp>
+
+#include <learnopengl/camera.h>
+
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// camera input events as they are stored in a recording. the file starts
+// with a header (magic, version, initial camera state) followed by events:
+//   float time | uint8 type | payload
+// where the payload is one byte of held keys for INPUT_KEYS, two floats for
+// INPUT_MOUSE and one float for INPUT_SCROLL. times are in seconds since the
+// recording started. the last event is an INPUT_END without payload, at the
+// time the recording was stopped; recordings without one end at their last
+// event.
+enum InputEventType {
+    INPUT_KEYS = 0,
+    INPUT_MOUSE = 1,
+    INPUT_SCROLL = 2,
+    INPUT_END = 3
+};
+
+// bits of the held key mask, one per Camera_Movement
+enum InputKey {
+    INPUT_KEY_FORWARD = 1 << FORWARD,
+    INPUT_KEY_BACKWARD = 1 << BACKWARD,
+    INPUT_KEY_LEFT = 1 << LEFT,
+    INPUT_KEY_RIGHT = 1 << RIGHT
+};
+
+struct InputEvent {
+    float time;
+    unsigned char type;
+    unsigned char keys;
+    float x, y;
+};
+
+struct InputRecordingHeader {
+    char magic[4];
+    unsigned int version;
+    float position[3];
+    float yaw, pitch, zoom;
+};
+
+// writes the live camera input to a file
+class InputRecorder
+{
+public:
+    InputRecorder() : keyMask(0), startTime(0.0)
+    {
+    }
+
+    // opens the file and stores where the camera starts
+    // ------------------------------------------------------------------------
+    bool open(const char* path, const Camera& camera, double time)
+    {
+        file.open(path, std::ios::binary);
+        if (!file)
+        {
+            std::cout << "Failed to open input recording for writing: " << path << std::endl;
+            return false;
+        }
+        InputRecordingHeader header = { { 'C', 'A', 'M', 'R' }, 1,
+            { camera.Position.x, camera.Position.y, camera.Position.z }, camera.Yaw, camera.Pitch, camera.Zoom };
+        file.write((const char*)&header, sizeof(header));
+        startTime = time;
+        return true;
+    }
+
+    bool isRecording() const
+    {
+        return file.is_open();
+    }
+
+    // the held keys are only written when they change
+    // ------------------------------------------------------------------------
+    void keys(double time, unsigned char mask)
+    {
+        if (!isRecording() || mask == keyMask)
+            return;
+        keyMask = mask;
+        writeHeader(time, INPUT_KEYS);
+        file.put((char)mask);
+    }
+
+    void mouse(double time, float xoffset, float yoffset)
+    {
+        if (!isRecording())
+            return;
+        writeHeader(time, INPUT_MOUSE);
+        file.write((const char*)&xoffset, sizeof(float));
+        file.write((const char*)&yoffset, sizeof(float));
+    }
+
+    void scroll(double time, float yoffset)
+    {
+        if (!isRecording())
+            return;
+        writeHeader(time, INPUT_SCROLL);
+        file.write((const char*)&yoffset, sizeof(float));
+    }
+
+    // marks when the recording stopped, so a replay keeps going (with the
+    // last keys held) until then rather than stopping at the last event
+    // ------------------------------------------------------------------------
+    void close(double time)
+    {
+        if (!isRecording())
+            return;
+        writeHeader(time, INPUT_END);
+        file.close();
+    }
+
+private:
+    std::ofstream file;
+    unsigned char keyMask;
+    double startTime;
+
+    void writeHeader(double time, unsigned char type)
+    {
+        float t = (float)(time - startTime);
+        file.write((const char*)&t, sizeof(float));
+        file.put((char)type);
+    }
+};
+
+// plays a recording back on a fixed timestep: every step applies the events
+// that happened up to the step's time and moves the camera for the keys held,
+// so the walkthrough is the same no matter how fast frames are rendered
+class InputReplay
+{
+public:
+    static constexpr float STEP = 1.0f / 60.0f;
+
+    InputReplay() : active(false), next(0), step(0), keyMask(0), endTime(0.0f)
+    {
+    }
+
+    // reads the whole recording and resets the camera to its starting state
+    // ------------------------------------------------------------------------
+    bool open(const char* path, Camera& camera)
+    {
+        std::ifstream file(path, std::ios::binary);
+        InputRecordingHeader header;
+        if (!file || !file.read((char*)&header, sizeof(header)) || std::string(header.magic, 4) != "CAMR" || header.version != 1)
+        {
+            std::cout << "Failed to read input recording: " << path << std::endl;
+            return false;
+        }
+        InputEvent event;
+        while (file.read((char*)&event.time, sizeof(float)))
+        {
+            event.type = (unsigned char)file.get();
+            event.keys = 0;
+            event.x = event.y = 0.0f;
+            if (event.type == INPUT_KEYS)
+                event.keys = (unsigned char)file.get();
+            else if (event.type == INPUT_MOUSE)
+            {
+                file.read((char*)&event.x, sizeof(float));
+                file.read((char*)&event.y, sizeof(float));
+            }
+            else if (event.type == INPUT_SCROLL)
+                file.read((char*)&event.y, sizeof(float));
+            if (!file)
+                break;
+            if (event.type == INPUT_END)
+            {
+                endTime = event.time;
+                break;
+            }
+            events.push_back(event);
+            endTime = event.time;
+        }
+        camera.Position = glm::vec3(header.position[0], header.position[1], header.position[2]);
+        camera.Yaw = header.yaw;
+        camera.Pitch = header.pitch;
+        camera.Zoom = header.zoom;
+        camera.ProcessMouseMovement(0.0f, 0.0f); // recomputes the camera vectors
+        active = true;
+        return true;
+    }
+
+    bool isActive() const
+    {
+        return active;
+    }
+
+    // advances the camera by one STEP; returns false once the recording is over
+    // ------------------------------------------------------------------------
+    bool advance(Camera& camera)
+    {
+        if (!active || step * STEP >= endTime)
+            return false;
+        float time = ++step * STEP;
+        for (; next < events.size() && events[next].time <= time; ++next)
+        {
+            const InputEvent& event = events[next];
+            if (event.type == INPUT_KEYS)
+                keyMask = event.keys;
+            else if (event.type == INPUT_MOUSE)
+                camera.ProcessMouseMovement(event.x, event.y);
+            else if (event.type == INPUT_SCROLL)
+                camera.ProcessMouseScroll(event.y);
+        }
+        if (keyMask & INPUT_KEY_FORWARD)
+            camera.ProcessKeyboard(FORWARD, STEP);
+        if (keyMask & INPUT_KEY_BACKWARD)
+            camera.ProcessKeyboard(BACKWARD, STEP);
+        if (keyMask & INPUT_KEY_LEFT)
+            camera.ProcessKeyboard(LEFT, STEP);
+        if (keyMask & INPUT_KEY_RIGHT)
+            camera.ProcessKeyboard(RIGHT, STEP);
+        return true;
+    }
+
+private:
+    bool active;
+    std::vector<InputEvent> events;
+    size_t next;
+    unsigned int step;
+    unsigned char keyMask;
+    float endTime; // when the recording was stopped
+};
+
+#endif
@@ -0,0 +1,85 @@
+#ifndef INSTANCING_H
+#define INSTANCING_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+
+// where the vertex shaders read per-instance data; the matrix takes one
+// location per column (4 to 7)
+const unsigned int INSTANCE_MODEL_LOCATION = 4;
+const unsigned int INSTANCE_MATERIAL_LOCATION = 8;
+
+// one copy of a mesh: where it stands in the world and which layer of the
+// material array it samples (only the array shader reads the material)
+struct InstanceData {
+    glm::mat4 model;
+    float material;
+};
+
+// the values the instance attributes have in vertex arrays without an
+// instance buffer: an identity matrix and material 0, so every non-instanced
+// draw goes through the same shaders unchanged. GL 3.3 leaves these undefined
+// after a draw that read them from a buffer, so they are set again after each
+// instanced draw
+// ---------------------------------------------------------------------------
+inline void setDefaultInstanceAttributes()
+{
+    for (unsigned int column = 0; column < 4; ++column)
+        glVertexAttrib4f(INSTANCE_MODEL_LOCATION + column, column == 0 ? 1.0f : 0.0f, column == 1 ? 1.0f : 0.0f,
+                         column == 2 ? 1.0f : 0.0f, column == 3 ? 1.0f : 0.0f);
+    glVertexAttrib1f(INSTANCE_MATERIAL_LOCATION, 0.0f);
+}
+
+// per-instance transforms and materials on the GPU, attached once to the
+// vertex array of every mesh drawn with them; see
+// MeshRegistry::attachInstances
+class InstanceBuffer
+{
+public:
+    unsigned int VBO;
+    unsigned int count;
+
+    InstanceBuffer() : VBO(0), count(0)
+    {
+    }
+
+    void upload(const std::vector<InstanceData>& instances)
+    {
+        if (!VBO)
+            glGenBuffers(1, &VBO);
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        glBufferData(GL_ARRAY_BUFFER, instances.size() * sizeof(InstanceData), instances.empty() ? NULL : &instances[0], GL_STATIC_DRAW);
+        count = static_cast<unsigned int>(instances.size());
+    }
+
+    // points the instance attributes of the bound vertex array at this
+    // buffer, advancing once per instance. the vertex array keeps them, so
+    // this is done once when it is set up, not per draw
+    // ------------------------------------------------------------------------
+    void attach() const
+    {
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        for (unsigned int column = 0; column < 4; ++column)
+        {
+            glEnableVertexAttribArray(INSTANCE_MODEL_LOCATION + column);
+            glVertexAttribPointer(INSTANCE_MODEL_LOCATION + column, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData),
+                                  (void*)(column * sizeof(glm::vec4)));
+            glVertexAttribDivisor(INSTANCE_MODEL_LOCATION + column, 1);
+        }
+        glEnableVertexAttribArray(INSTANCE_MATERIAL_LOCATION);
+        glVertexAttribPointer(INSTANCE_MATERIAL_LOCATION, 1, GL_FLOAT, GL_FALSE, sizeof(InstanceData), (void*)sizeof(glm::mat4));
+        glVertexAttribDivisor(INSTANCE_MATERIAL_LOCATION, 1);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+
+    void release()
+    {
+        glDeleteBuffers(1, &VBO);
+        VBO = 0;
+        count = 0;
+    }
+};
+
+#endif
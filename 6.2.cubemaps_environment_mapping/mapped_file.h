@@ -0,0 +1,130 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <cstddef>
+#include <iostream>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// a read-only view of a whole file through the virtual memory system; the
+// contents are paged in on first touch instead of being read into a buffer
+class MappedFile
+{
+public:
+    MappedFile() : data(NULL), size(0)
+    {
+#ifdef _WIN32
+        file = INVALID_HANDLE_VALUE;
+        mapping = NULL;
+#endif
+    }
+
+    ~MappedFile()
+    {
+        close();
+    }
+
+    // maps the file; false if it can't be opened or is empty
+    // ------------------------------------------------------------------------
+    bool open(const char* path)
+    {
+        close();
+#ifdef _WIN32
+        file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+        if (file == INVALID_HANDLE_VALUE)
+            return false;
+        LARGE_INTEGER fileSize;
+        if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0)
+        {
+            close();
+            return false;
+        }
+        mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (mapping)
+            data = (const unsigned char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        if (!data)
+        {
+            std::cout << "Failed to map file: " << path << std::endl;
+            close();
+            return false;
+        }
+        size = (size_t)fileSize.QuadPart;
+#else
+        int descriptor = ::open(path, O_RDONLY);
+        if (descriptor < 0)
+            return false;
+        struct stat info;
+        if (fstat(descriptor, &info) != 0 || info.st_size == 0)
+        {
+            ::close(descriptor);
+            return false;
+        }
+        void* view = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+        ::close(descriptor); // the mapping keeps its own reference to the file
+        if (view == MAP_FAILED)
+        {
+            std::cout << "Failed to map file: " << path << std::endl;
+            return false;
+        }
+        // everything gets read once, front to back. the advice values are an
+        // enumeration, not flags, so each one takes its own call
+        madvise(view, (size_t)info.st_size, MADV_SEQUENTIAL);
+        madvise(view, (size_t)info.st_size, MADV_WILLNEED);
+        data = (const unsigned char*)view;
+        size = (size_t)info.st_size;
+#endif
+        return true;
+    }
+
+    bool isOpen() const
+    {
+        return data != NULL;
+    }
+
+    void close()
+    {
+#ifdef _WIN32
+        if (data)
+            UnmapViewOfFile(data);
+        if (mapping)
+            CloseHandle(mapping);
+        if (file != INVALID_HANDLE_VALUE)
+            CloseHandle(file);
+        file = INVALID_HANDLE_VALUE;
+        mapping = NULL;
+#else
+        if (data)
+            munmap((void*)data, size);
+#endif
+        data = NULL;
+        size = 0;
+    }
+
+    const unsigned char* data;
+    size_t size;
+
+private:
+    // views can't be shared, the destructor unmaps
+    MappedFile(const MappedFile&);
+    MappedFile& operator=(const MappedFile&);
+
+#ifdef _WIN32
+    HANDLE file;
+    HANDLE mapping;
+#endif
+};
+
+#endif
@@ -0,0 +1,168 @@
+#ifndef MATERIAL_ARRAY_H
+#define MATERIAL_ARRAY_H
+
+#include <glad/glad.h>
+
+#include "image_decode.h"
+#include "thread_pool.h"
+
+#include <chrono>
+#include <future>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+// copies a position + texture coordinate array and appends the layer to every vertex
+// -----------------------------------------------------------------------------------
+inline std::vector<float> appendLayer(const float* vertices, size_t sizeInBytes, unsigned int layer)
+{
+    std::vector<float> result;
+    size_t count = sizeInBytes / (5 * sizeof(float));
+    for (size_t i = 0; i < count; ++i)
+    {
+        result.insert(result.end(), vertices + i * 5, vertices + i * 5 + 5);
+        result.push_back((float)layer);
+    }
+    return result;
+}
+
+// material textures stored as layers of one GL_TEXTURE_2D_ARRAY so surfaces
+// with different textures can go out in a single draw. every layer has the
+// same size; images of another size are resized on load.
+class MaterialArray
+{
+public:
+    unsigned int ID;
+    int width;
+    int height;
+
+    MaterialArray(int width, int height) : ID(0), width(width), height(height)
+    {
+    }
+
+    // queues a texture and returns its layer; the same path gets the same layer
+    // ------------------------------------------------------------------------
+    unsigned int add(const std::string& path)
+    {
+        std::map<std::string, unsigned int>::iterator it = layers.find(path);
+        if (it != layers.end())
+            return it->second;
+        unsigned int layer = static_cast<unsigned int>(paths.size());
+        paths.push_back(path);
+        layers[path] = layer;
+        return layer;
+    }
+
+    // decodes every queued texture on the pool, each resized to the layer
+    // size and with its mips built by decodeTexture(), and uploads the array
+    // ------------------------------------------------------------------------
+    void build(ThreadPool& pool)
+    {
+        std::vector<std::future<DecodedImage> > decoded;
+        int layerWidth = width, layerHeight = height;
+        for (const std::string& path : paths)
+            decoded.push_back(pool.submit([path, layerWidth, layerHeight]() { return decodeTexture(path, false, layerWidth, layerHeight); }));
+
+        glGenTextures(1, &ID);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, ID);
+        int levelWidth = width, levelHeight = height;
+        for (int level = 0;; ++level)
+        {
+            glTexImage3D(GL_TEXTURE_2D_ARRAY, level, GL_RGBA8, levelWidth, levelHeight, (GLsizei)paths.size(), 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+            if (levelWidth == 1 && levelHeight == 1)
+                break;
+            levelWidth = levelWidth > 1 ? levelWidth / 2 : 1;
+            levelHeight = levelHeight > 1 ? levelHeight / 2 : 1;
+        }
+
+        for (unsigned int layer = 0; layer < paths.size(); ++layer)
+        {
+            DecodedImage image = decoded[layer].get();
+            if (!image.data)
+            {
+                std::cout << "Material texture failed to load at path: " << paths[layer] << std::endl;
+                continue;
+            }
+            uploadLayer(layer, image);
+            freeImage(image);
+        }
+
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    }
+
+    // decodes one layer's file again on the pool, like TextureManager::reload;
+    // update() replaces the layer once the decode is done. false if the path
+    // isn't one of our layers
+    // ------------------------------------------------------------------------
+    bool reload(const std::string& path, ThreadPool& pool)
+    {
+        if (!layers.count(path) || !ID)
+            return false;
+        int layerWidth = width, layerHeight = height;
+        reloads.push_back(pool.submit([path, layerWidth, layerHeight]() { return decodeTexture(path, false, layerWidth, layerHeight); }));
+        return true;
+    }
+
+    // uploads the reloads that finished decoding; never waits for one. a file
+    // that fails to decode keeps its layer as it was
+    // ------------------------------------------------------------------------
+    unsigned int update()
+    {
+        unsigned int replaced = 0;
+        for (size_t i = 0; i < reloads.size();)
+        {
+            if (reloads[i].wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+            {
+                ++i;
+                continue;
+            }
+            DecodedImage image = reloads[i].get();
+            reloads.erase(reloads.begin() + i);
+            if (!image.data)
+                std::cout << "Keeping the previous version of " << image.path << std::endl;
+            else if (ID)
+            {
+                glBindTexture(GL_TEXTURE_2D_ARRAY, ID);
+                uploadLayer(layers[image.path], image);
+                replaced++;
+            }
+            freeImage(image);
+        }
+        return replaced;
+    }
+
+    void release()
+    {
+        for (std::future<DecodedImage>& reload : reloads)
+        {
+            DecodedImage image = reload.get();
+            freeImage(image);
+        }
+        reloads.clear();
+        glDeleteTextures(1, &ID);
+        ID = 0;
+    }
+
+private:
+    std::vector<std::string> paths;
+    std::map<std::string, unsigned int> layers;
+    std::vector<std::future<DecodedImage> > reloads;
+
+    // copies an image decoded at the layer size and its mips into one layer
+    // of the bound array
+    void uploadLayer(unsigned int layer, const DecodedImage& image)
+    {
+        glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, layer, width, height, 1, GL_RGBA, GL_UNSIGNED_BYTE, image.data);
+        for (size_t i = 0; i < image.mips.size(); ++i)
+        {
+            const MipLevel& level = image.mips[i];
+            glTexSubImage3D(GL_TEXTURE_2D_ARRAY, (GLint)i + 1, 0, 0, layer, level.width, level.height, 1, GL_RGBA, GL_UNSIGNED_BYTE, &level.data[0]);
+        }
+    }
+};
+
+#endif
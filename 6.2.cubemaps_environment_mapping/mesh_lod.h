@@ -0,0 +1,133 @@
+#ifndef MESH_LOD_H
+#define MESH_LOD_H
+
+#include <glm/glm.hpp>
+
+#include "bounds.h"
+
+#include <cfloat>
+#include <ostream>
+#include <vector>
+
+// how far past a threshold the projected size must move before the level
+// changes, as a fraction of the threshold; keeps objects that sit right at a
+// threshold from switching back and forth every frame
+const float LOD_HYSTERESIS = 0.15f;
+
+// the height in pixels a world-space sphere covers on screen; FLT_MAX when the
+// camera is inside it
+// ---------------------------------------------------------------------------
+inline float projectedDiameter(const BoundingSphere& sphere, const glm::vec3& cameraPosition, const glm::mat4& projection, float viewportHeight)
+{
+    float distance = glm::length(sphere.center - cameraPosition);
+    if (distance <= sphere.radius)
+        return FLT_MAX;
+    // projection[1][1] is cot(fovy / 2): NDC units per unit of height at distance 1
+    return sphere.radius * projection[1][1] / distance * viewportHeight;
+}
+
+// the projected diameter up to which a round mesh with this many segments
+// around keeps its edges shorter than edgePixels on screen
+// ---------------------------------------------------------------------------
+inline float lodMaxPixels(unsigned int segments, float edgePixels = 8.0f)
+{
+    return segments * edgePixels / 3.14159265358979f;
+}
+
+// one version of a mesh in a chain: the registry handle to draw, its triangle
+// count and the largest projected size it is good enough for
+struct LodLevel {
+    unsigned int mesh;
+    unsigned int triangles;
+    float maxPixels;
+};
+
+// the versions of one mesh from full detail (level 0) down, and the level the
+// object was drawn with last frame
+class LodChain
+{
+public:
+    LodChain() : current(0)
+    {
+    }
+
+    // levels go from fine to coarse; level 0 is used at any size
+    // ------------------------------------------------------------------------
+    void addLevel(unsigned int mesh, unsigned int triangles, float maxPixels)
+    {
+        LodLevel level = { mesh, triangles, levels.empty() ? FLT_MAX : maxPixels };
+        levels.push_back(level);
+    }
+
+    // picks the coarsest level good enough for an object this many pixels
+    // tall, moving from last frame's level only once the size is clearly past
+    // a threshold; returns the mesh to draw
+    // ------------------------------------------------------------------------
+    unsigned int update(float pixels)
+    {
+        while (current > 0 && pixels > levels[current].maxPixels * (1.0f + LOD_HYSTERESIS))
+            current--;
+        while (current + 1 < levels.size() && pixels < levels[current + 1].maxPixels * (1.0f - LOD_HYSTERESIS))
+            current++;
+        return levels[current].mesh;
+    }
+
+    unsigned int currentLevel() const
+    {
+        return current;
+    }
+
+    const LodLevel& level(unsigned int index) const
+    {
+        return levels[index];
+    }
+
+    size_t size() const
+    {
+        return levels.size();
+    }
+
+private:
+    std::vector<LodLevel> levels;
+    unsigned int current;
+};
+
+// triangles drawn through LOD chains against what full detail would have
+// drawn, for the last frame and on average
+struct LodStats {
+    unsigned long long submitted;
+    unsigned long long fullDetail;
+    unsigned long long totalSubmitted;
+    unsigned long long totalFullDetail;
+    unsigned long long frames;
+
+    LodStats() : submitted(0), fullDetail(0), totalSubmitted(0), totalFullDetail(0), frames(0)
+    {
+    }
+
+    void beginFrame()
+    {
+        submitted = 0;
+        fullDetail = 0;
+        frames++;
+    }
+
+    // counts one draw of the chain's current level
+    void count(const LodChain& chain, unsigned int instances = 1)
+    {
+        submitted += (unsigned long long)chain.level(chain.currentLevel()).triangles * instances;
+        fullDetail += (unsigned long long)chain.level(0).triangles * instances;
+        totalSubmitted += (unsigned long long)chain.level(chain.currentLevel()).triangles * instances;
+        totalFullDetail += (unsigned long long)chain.level(0).triangles * instances;
+    }
+
+    void print(std::ostream& out) const
+    {
+        if (!frames || !totalFullDetail)
+            return;
+        out << "lod: " << submitted << " of " << fullDetail << " triangles last frame, "
+            << 100 * totalSubmitted / totalFullDetail << "% of full detail over " << frames << " frames" << std::endl;
+    }
+};
+
+#endif
@@ -0,0 +1,345 @@
+#ifndef MESH_OPTIMIZER_H
+#define MESH_OPTIMIZER_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "fnv_hash.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iomanip>
+#include <ostream>
+#include <unordered_map>
+#include <vector>
+
+// load time mesh optimization for the static geometry:
+//   1. weld bit-identical vertices of a triangle soup into an indexed mesh
+//   2. order the triangles for the post-transform vertex cache (Tipsify,
+//      Sander et al. 2007), which also splits them into clusters
+//   3. order those clusters outside-in, so near surfaces tend to be drawn
+//      before what they cover (less overdraw)
+//   4. renumber the vertices in order of first use, for fetch locality
+// the cache simulated throughout is a FIFO of this many vertices, a safe
+// lower bound for the hardware we run on
+const unsigned int MESH_CACHE_SIZE = 16;
+// a cluster that grew this large is closed at the next fan, so one connected
+// surface (a dome, a cylinder) still gets pieces the overdraw pass can sort
+const unsigned int MESH_CLUSTER_TRIANGLES = 64;
+
+struct OptimizedMesh {
+    std::vector<float> vertices;
+    std::vector<unsigned int> indices;
+};
+
+// what optimizing one mesh bought
+struct MeshOptimizationReport {
+    unsigned int verticesBefore;
+    unsigned int verticesAfter;
+    unsigned int triangles;
+    float acmrBefore;   // average cache miss ratio: transformed vertices per triangle
+    float acmrAfter;
+
+    void print(std::ostream& out, const char* name) const
+    {
+        out << std::fixed << std::setprecision(2) << "mesh " << name << ": " << verticesBefore << " -> " << verticesAfter
+            << " vertices, ACMR " << acmrBefore << " -> " << acmrAfter << " over " << triangles << " triangles" << std::endl;
+        out.unsetf(std::ios::floatfield);
+    }
+};
+
+// vertices a FIFO cache of cacheSize would transform for this index order,
+// per triangle (1.0 is a strip, 0.5 the best a regular grid can do, 3.0 none)
+// ---------------------------------------------------------------------------
+inline float averageCacheMissRatio(const unsigned int* indices, size_t indexCount, unsigned int vertexCount, unsigned int cacheSize = MESH_CACHE_SIZE)
+{
+    if (indexCount < 3)
+        return 0.0f;
+    std::vector<unsigned int> insertedAt(vertexCount, 0);
+    unsigned int misses = 0;
+    for (size_t i = 0; i < indexCount; ++i)
+    {
+        unsigned int v = indices[i];
+        // a vertex is in the cache while fewer than cacheSize misses came after it
+        if (!insertedAt[v] || misses + 1 - insertedAt[v] > cacheSize)
+        {
+            misses++;
+            insertedAt[v] = misses;
+        }
+    }
+    return (float)misses / (float)(indexCount / 3);
+}
+
+// merges vertices whose floats are bit-identical; indices may be NULL for a
+// triangle soup. returns the welded vertices and the indices into them
+// ---------------------------------------------------------------------------
+inline OptimizedMesh weldVertices(const float* vertices, unsigned int vertexCount, unsigned int floatsPerVertex, const unsigned int* indices, size_t indexCount)
+{
+    OptimizedMesh mesh;
+    size_t vertexBytes = floatsPerVertex * sizeof(float);
+    std::unordered_multimap<unsigned long long, unsigned int> byHash;
+    std::vector<unsigned int> remap(vertexCount);
+    for (unsigned int v = 0; v < vertexCount; ++v)
+    {
+        const float* vertex = vertices + (size_t)v * floatsPerVertex;
+        unsigned long long hash = fnv1a64((const unsigned char*)vertex, vertexBytes);
+        unsigned int welded = (unsigned int)(mesh.vertices.size() / floatsPerVertex);
+        std::pair<std::unordered_multimap<unsigned long long, unsigned int>::iterator, std::unordered_multimap<unsigned long long, unsigned int>::iterator> same = byHash.equal_range(hash);
+        for (; same.first != same.second; ++same.first)
+        {
+            if (memcmp(&mesh.vertices[(size_t)same.first->second * floatsPerVertex], vertex, vertexBytes) == 0)
+            {
+                welded = same.first->second;
+                break;
+            }
+        }
+        if (welded == mesh.vertices.size() / floatsPerVertex)
+        {
+            mesh.vertices.insert(mesh.vertices.end(), vertex, vertex + floatsPerVertex);
+            byHash.insert(std::make_pair(hash, welded));
+        }
+        remap[v] = welded;
+    }
+    size_t count = indices ? indexCount : vertexCount;
+    for (size_t i = 0; i < count; ++i)
+        mesh.indices.push_back(remap[indices ? indices[i] : (unsigned int)i]);
+    return mesh;
+}
+
+// Tipsify: fans around one vertex at a time, picking the next one among the
+// vertices just used that will still be in the cache when its remaining
+// triangles come up. returns the new triangle order and writes the first
+// triangle of every cluster. as in Sander et al., a cluster ends where the
+// cache is flushed, i.e. where no candidate was left in it and the next fan
+// comes from the dead-end stack or a scan; it also ends after a fan once it
+// holds MESH_CLUSTER_TRIANGLES
+// ---------------------------------------------------------------------------
+inline std::vector<unsigned int> tipsify(const std::vector<unsigned int>& indices, unsigned int vertexCount, unsigned int cacheSize,
+                                         std::vector<unsigned int>& clusterStarts)
+{
+    unsigned int triangleCount = (unsigned int)(indices.size() / 3);
+    // triangles around each vertex
+    std::vector<unsigned int> live(vertexCount, 0), offsets(vertexCount + 1, 0);
+    for (unsigned int index : indices)
+        live[index]++;
+    for (unsigned int v = 0; v < vertexCount; ++v)
+        offsets[v + 1] = offsets[v] + live[v];
+    std::vector<unsigned int> adjacency(indices.size()), fill(offsets.begin(), offsets.end() - 1);
+    for (unsigned int t = 0; t < triangleCount; ++t)
+        for (int corner = 0; corner < 3; ++corner)
+            adjacency[fill[indices[t * 3 + corner]]++] = t;
+
+    std::vector<unsigned int> cacheTime(vertexCount, 0), deadEnds, candidates, order;
+    std::vector<bool> emitted(triangleCount, false);
+    unsigned int time = cacheSize + 1;
+    unsigned int cursor = 0;
+    int fanning = vertexCount ? 0 : -1;
+    bool cold = true;
+    while (fanning >= 0)
+    {
+        candidates.clear();
+        for (unsigned int a = offsets[fanning]; a < offsets[fanning + 1]; ++a)
+        {
+            unsigned int t = adjacency[a];
+            if (emitted[t])
+                continue;
+            if (cold)
+                clusterStarts.push_back((unsigned int)order.size());
+            cold = false;
+            for (int corner = 0; corner < 3; ++corner)
+            {
+                unsigned int v = indices[t * 3 + corner];
+                deadEnds.push_back(v);
+                candidates.push_back(v);
+                live[v]--;
+                if (time - cacheTime[v] > cacheSize)
+                    cacheTime[v] = time++;
+            }
+            order.push_back(t);
+            emitted[t] = true;
+        }
+
+        // the candidate still in cache after its remaining triangles are drawn
+        // that has been there longest; else (a cache flush, which starts a
+        // new cluster) the most recent dead end, or a scan for any vertex with
+        // triangles left
+        int next = -1;
+        unsigned int bestPriority = 0;
+        for (unsigned int v : candidates)
+        {
+            if (!live[v])
+                continue;
+            unsigned int priority = 0;
+            if (time - cacheTime[v] + 2 * live[v] <= cacheSize)
+                priority = time - cacheTime[v];
+            if (priority > bestPriority)
+            {
+                bestPriority = priority;
+                next = (int)v;
+            }
+        }
+        if (next < 0)
+            cold = true;
+        while (next < 0 && !deadEnds.empty())
+        {
+            unsigned int v = deadEnds.back();
+            deadEnds.pop_back();
+            if (live[v])
+                next = (int)v;
+        }
+        for (; next < 0 && cursor < vertexCount; ++cursor)
+            if (live[cursor])
+                next = (int)cursor;
+        if (!clusterStarts.empty() && order.size() - clusterStarts.back() >= MESH_CLUSTER_TRIANGLES)
+            cold = true;
+        fanning = next;
+    }
+    return order;
+}
+
+// sorts the clusters so the ones facing away from the mesh's center, the
+// outer surfaces, come first
+// ---------------------------------------------------------------------------
+inline std::vector<unsigned int> sortClustersForOverdraw(const std::vector<unsigned int>& indices, const std::vector<unsigned int>& order,
+                                                         const std::vector<unsigned int>& clusterStarts,
+                                                         const float* vertices, unsigned int floatsPerVertex, unsigned int positionOffset)
+{
+    unsigned int triangleCount = (unsigned int)order.size();
+    std::vector<glm::vec3> centroids, normals;
+    std::vector<float> areas;
+    glm::vec3 meshCentroid(0.0f);
+    float meshArea = 0.0f;
+    for (size_t c = 0; c < clusterStarts.size(); ++c)
+    {
+        unsigned int end = c + 1 < clusterStarts.size() ? clusterStarts[c + 1] : triangleCount;
+        glm::vec3 centroid(0.0f), normal(0.0f);
+        float area = 0.0f;
+        for (unsigned int i = clusterStarts[c]; i < end; ++i)
+        {
+            glm::vec3 p[3];
+            for (int corner = 0; corner < 3; ++corner)
+            {
+                const float* position = vertices + (size_t)indices[order[i] * 3 + corner] * floatsPerVertex + positionOffset;
+                p[corner] = glm::vec3(position[0], position[1], position[2]);
+            }
+            glm::vec3 cross = glm::cross(p[1] - p[0], p[2] - p[0]);
+            float triangleArea = glm::length(cross) * 0.5f;
+            centroid += (p[0] + p[1] + p[2]) * (triangleArea / 3.0f);
+            normal += cross;
+            area += triangleArea;
+        }
+        meshCentroid += centroid;
+        meshArea += area;
+        centroids.push_back(area > 0.0f ? centroid * (1.0f / area) : centroid);
+        float length = glm::length(normal);
+        normals.push_back(length > 0.0f ? normal * (1.0f / length) : normal);
+        areas.push_back(area);
+    }
+    if (meshArea > 0.0f)
+        meshCentroid = meshCentroid * (1.0f / meshArea);
+
+    std::vector<std::pair<float, unsigned int> > keyed;
+    for (unsigned int c = 0; c < clusterStarts.size(); ++c)
+        keyed.push_back(std::make_pair(-glm::dot(centroids[c] - meshCentroid, normals[c]), c));
+    std::stable_sort(keyed.begin(), keyed.end(), [](const std::pair<float, unsigned int>& a, const std::pair<float, unsigned int>& b) { return a.first < b.first; });
+
+    std::vector<unsigned int> sorted;
+    for (const std::pair<float, unsigned int>& cluster : keyed)
+    {
+        unsigned int end = cluster.second + 1 < clusterStarts.size() ? clusterStarts[cluster.second + 1] : triangleCount;
+        sorted.insert(sorted.end(), order.begin() + clusterStarts[cluster.second], order.begin() + end);
+    }
+    return sorted;
+}
+
+// runs every step on one mesh; indices may be NULL for a triangle soup.
+// positionOffset is where the position is inside a vertex, in floats
+// ---------------------------------------------------------------------------
+inline MeshOptimizationReport optimizeMesh(const float* vertices, unsigned int vertexCount, unsigned int floatsPerVertex,
+                                           const unsigned int* indices, size_t indexCount, OptimizedMesh& result, unsigned int positionOffset = 0)
+{
+    MeshOptimizationReport report;
+    report.verticesBefore = vertexCount;
+    if (indices)
+        report.acmrBefore = averageCacheMissRatio(indices, indexCount, vertexCount);
+    else
+        report.acmrBefore = vertexCount >= 3 ? 3.0f : 0.0f;
+
+    OptimizedMesh welded = weldVertices(vertices, vertexCount, floatsPerVertex, indices, indexCount);
+    unsigned int weldedCount = (unsigned int)(welded.vertices.size() / (floatsPerVertex ? floatsPerVertex : 1));
+    std::vector<unsigned int> clusterStarts;
+    std::vector<unsigned int> order = tipsify(welded.indices, weldedCount, MESH_CACHE_SIZE, clusterStarts);
+    order = sortClustersForOverdraw(welded.indices, order, clusterStarts, welded.vertices.empty() ? NULL : &welded.vertices[0], floatsPerVertex, positionOffset);
+
+    // renumber the vertices as the new triangle order first reaches them
+    const unsigned int UNUSED = 0xFFFFFFFF;
+    std::vector<unsigned int> remap(weldedCount, UNUSED);
+    result.vertices.clear();
+    result.indices.clear();
+    for (unsigned int t : order)
+    {
+        for (int corner = 0; corner < 3; ++corner)
+        {
+            unsigned int v = welded.indices[t * 3 + corner];
+            if (remap[v] == UNUSED)
+            {
+                remap[v] = (unsigned int)(result.vertices.size() / floatsPerVertex);
+                result.vertices.insert(result.vertices.end(), &welded.vertices[(size_t)v * floatsPerVertex], &welded.vertices[(size_t)v * floatsPerVertex] + floatsPerVertex);
+            }
+            result.indices.push_back(remap[v]);
+        }
+    }
+
+    report.verticesAfter = (unsigned int)(result.vertices.size() / (floatsPerVertex ? floatsPerVertex : 1));
+    report.triangles = (unsigned int)(result.indices.size() / 3);
+    report.acmrAfter = result.indices.empty() ? 0.0f : averageCacheMissRatio(&result.indices[0], result.indices.size(), report.verticesAfter);
+    return report;
+}
+
+// 16-bit indices whenever every vertex can be addressed with them
+// ---------------------------------------------------------------
+inline GLenum chooseIndexType(size_t vertexCount)
+{
+    return vertexCount <= 65536 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+}
+
+inline size_t indexTypeSize(GLenum type)
+{
+    return type == GL_UNSIGNED_SHORT ? sizeof(unsigned short) : sizeof(unsigned int);
+}
+
+// uploads indices that are already stored in the given type (e.g. 16-bit
+// indices of a mesh optimized offline) to the bound GL_ELEMENT_ARRAY_BUFFER
+// as they are
+// -----------------------------------------------------------------------
+inline void uploadIndices(const void* indices, size_t indexCount, GLenum type)
+{
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexCount * indexTypeSize(type), indices, GL_STATIC_DRAW);
+}
+
+// uploads 32-bit indices to the bound GL_ELEMENT_ARRAY_BUFFER in the given
+// type; 16-bit ones are narrowed straight into the mapped buffer
+// -----------------------------------------------------------------------
+inline void uploadIndices(const unsigned int* indices, size_t indexCount, GLenum type)
+{
+    if (type != GL_UNSIGNED_SHORT || indexCount == 0)
+    {
+        uploadIndices((const void*)indices, indexCount, type);
+        return;
+    }
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexCount * sizeof(unsigned short), NULL, GL_STATIC_DRAW);
+    unsigned short* narrow = (unsigned short*)glMapBufferRange(GL_ELEMENT_ARRAY_BUFFER, 0, indexCount * sizeof(unsigned short),
+                                                               GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+    if (!narrow)
+    {
+        // no mapping, e.g. out of address space: narrow on the side instead
+        std::vector<unsigned short> copy(indices, indices + indexCount);
+        uploadIndices((const void*)&copy[0], indexCount, type);
+        return;
+    }
+    for (size_t i = 0; i < indexCount; ++i)
+        narrow[i] = (unsigned short)indices[i];
+    glUnmapBuffer(GL_ELEMENT_ARRAY_BUFFER);
+}
+
+#endif
@@ -0,0 +1,150 @@
+#ifndef MESH_REGISTRY_H
+#define MESH_REGISTRY_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "instancing.h"
+#include "mesh_optimizer.h"
+#include "vertex_format.h"
+
+#include <vector>
+
+// a mesh that lives on the GPU for as long as the registry does
+struct RetainedMesh {
+    unsigned int VAO;
+    unsigned int VBO;
+    unsigned int EBO;         // 0 for non-indexed meshes
+    GLenum mode;
+    unsigned int vertexCount;
+    unsigned int indexCount;
+    GLenum indexType;         // GL_UNSIGNED_SHORT when the vertex count allows it
+    glm::mat4 positionTransform; // from the stored positions to the mesh's own space
+    glm::vec4 uvTransform;       // uv scale (xy) and offset (zw), see QuantizedVertices
+    const InstanceBuffer* instances; // attached to the VAO, see MeshRegistry::attachInstances
+};
+
+// uploads static meshes once and hands out a stable handle for drawing them.
+// handles are indices into the registry and stay valid until release().
+class MeshRegistry
+{
+public:
+    // uploads an interleaved float array and returns the handle of the new mesh
+    // ------------------------------------------------------------------------
+    unsigned int add(const float* vertices, size_t sizeInBytes, unsigned int floatsPerVertex,
+                     const std::vector<VertexAttribute>& attributes, GLenum mode = GL_TRIANGLES)
+    {
+        return addIndexed(vertices, sizeInBytes, NULL, 0, floatsPerVertex, attributes, mode);
+    }
+
+    // same as add() but with an element buffer; indices may be NULL. they are
+    // stored as 16-bit when the mesh has few enough vertices, the vertices
+    // quantized if quantizeVerticesOnLoad() is set
+    // ------------------------------------------------------------------------
+    unsigned int addIndexed(const float* vertices, size_t sizeInBytes, const unsigned int* indices, unsigned int indexCount,
+                            unsigned int floatsPerVertex, const std::vector<VertexAttribute>& attributes, GLenum mode = GL_TRIANGLES)
+    {
+        RetainedMesh mesh;
+        mesh.mode = mode;
+        mesh.vertexCount = static_cast<unsigned int>(sizeInBytes / (floatsPerVertex * sizeof(float)));
+        mesh.indexCount = indices ? indexCount : 0;
+        mesh.EBO = 0;
+        mesh.indexType = chooseIndexType(mesh.vertexCount);
+        mesh.positionTransform = glm::mat4(1.0f);
+        mesh.uvTransform = glm::vec4(1.0f, 1.0f, 0.0f, 0.0f);
+        mesh.instances = NULL;
+        QuantizedVertices quantized;
+        bool quantize = quantizeVerticesOnLoad() && quantizeVertices(vertices, mesh.vertexCount, floatsPerVertex, attributes, quantized);
+
+        glGenVertexArrays(1, &mesh.VAO);
+        glGenBuffers(1, &mesh.VBO);
+        glBindVertexArray(mesh.VAO);
+        glBindBuffer(GL_ARRAY_BUFFER, mesh.VBO);
+        if (quantize)
+        {
+            glBufferData(GL_ARRAY_BUFFER, quantized.data.size() * sizeof(unsigned short), &quantized.data[0], GL_STATIC_DRAW);
+            mesh.positionTransform = quantized.positionTransform();
+            mesh.uvTransform = quantized.uvTransform();
+        }
+        else
+            glBufferData(GL_ARRAY_BUFFER, sizeInBytes, vertices, GL_STATIC_DRAW);
+        if (indices)
+        {
+            glGenBuffers(1, &mesh.EBO);
+            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.EBO);
+            uploadIndices(indices, indexCount, mesh.indexType);
+        }
+        if (quantize)
+            setVertexAttributes(quantized.attributes, quantized.stride);
+        else
+            setVertexAttributes(attributes, floatsPerVertex);
+        glBindVertexArray(0);
+
+        meshes.push_back(mesh);
+        return static_cast<unsigned int>(meshes.size() - 1);
+    }
+
+    // draws a previously registered mesh; the caller binds shader and textures
+    // ------------------------------------------------------------------------
+    void draw(unsigned int handle) const
+    {
+        const RetainedMesh& mesh = meshes[handle];
+        glBindVertexArray(mesh.VAO);
+        if (mesh.EBO)
+            glDrawElements(mesh.mode, mesh.indexCount, mesh.indexType, 0);
+        else
+            glDrawArrays(mesh.mode, 0, mesh.vertexCount);
+    }
+
+    // binds the instance buffer into the mesh's vertex array once; from then
+    // on every draw of the mesh is one copy per instance (render queue items
+    // made from it pick that up), with no per-draw attribute setup
+    // ------------------------------------------------------------------------
+    void attachInstances(unsigned int handle, const InstanceBuffer& instances)
+    {
+        RetainedMesh& mesh = meshes[handle];
+        glBindVertexArray(mesh.VAO);
+        instances.attach();
+        glBindVertexArray(0);
+        mesh.instances = &instances;
+    }
+
+    // draws one copy of the mesh per entry of its attached instance buffer
+    // with a single call; the shader reads each copy's transform from
+    // attributes 4-7
+    // ------------------------------------------------------------------------
+    void drawInstanced(unsigned int handle) const
+    {
+        const RetainedMesh& mesh = meshes[handle];
+        glBindVertexArray(mesh.VAO);
+        if (mesh.EBO)
+            glDrawElementsInstanced(mesh.mode, mesh.indexCount, mesh.indexType, 0, mesh.instances->count);
+        else
+            glDrawArraysInstanced(mesh.mode, 0, mesh.vertexCount, mesh.instances->count);
+        setDefaultInstanceAttributes();
+    }
+
+    const RetainedMesh& get(unsigned int handle) const
+    {
+        return meshes[handle];
+    }
+
+    // de-allocates every registered mesh; call before the context goes away
+    // ------------------------------------------------------------------------
+    void release()
+    {
+        for (RetainedMesh& mesh : meshes)
+        {
+            glDeleteVertexArrays(1, &mesh.VAO);
+            glDeleteBuffers(1, &mesh.VBO);
+            if (mesh.EBO)
+                glDeleteBuffers(1, &mesh.EBO);
+        }
+        meshes.clear();
+    }
+
+private:
+    std::vector<RetainedMesh> meshes;
+};
+
+#endif
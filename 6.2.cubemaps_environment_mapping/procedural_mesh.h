@@ -0,0 +1,241 @@
+#ifndef PROCEDURAL_MESH_H
+#define PROCEDURAL_MESH_H
+
+#include <glm/glm.hpp>
+
+#include "bounds.h"
+#include "mesh_registry.h"
+
+#include <cmath>
+#include <vector>
+
+// indexed triangle meshes built in code: cylinders, domes and prisms. every
+// vertex is position, normal, uv (8 floats); every triangle is wound counter
+// clockwise seen from the side its normals point to.
+const unsigned int PROCEDURAL_VERTEX_FLOATS = 8;
+
+struct ProceduralMesh {
+    std::vector<float> vertices;
+    std::vector<unsigned int> indices;
+    glm::vec3 boundsMin; // exact box of the positions
+    glm::vec3 boundsMax;
+};
+
+// the attribute layout for MeshRegistry / StaticGeometry: the shaders read uv
+// at location 1 and the normal at location 2
+// ---------------------------------------------------------------------------
+inline std::vector<VertexAttribute> proceduralMeshLayout()
+{
+    return { { 0, 3, 0 }, { 1, 2, 6 }, { 2, 3, 3 } };
+}
+
+// a sphere centered on the mesh's box, just big enough for its vertices
+// -----------------------------------------------------------------------
+inline BoundingSphere boundingSphere(const ProceduralMesh& mesh)
+{
+    BoundingSphere sphere = { (mesh.boundsMin + mesh.boundsMax) * 0.5f, 0.0f };
+    for (size_t v = 0; v < mesh.vertices.size(); v += PROCEDURAL_VERTEX_FLOATS)
+        sphere.radius = glm::max(sphere.radius, glm::length(glm::vec3(mesh.vertices[v], mesh.vertices[v + 1], mesh.vertices[v + 2]) - sphere.center));
+    return sphere;
+}
+
+// the mesh as position + uv vertices (5 floats), for geometry packed with the
+// hand written environment arrays
+// ---------------------------------------------------------------------------
+inline std::vector<float> positionTexCoordVertices(const ProceduralMesh& mesh)
+{
+    std::vector<float> vertices;
+    for (size_t v = 0; v < mesh.vertices.size(); v += PROCEDURAL_VERTEX_FLOATS)
+    {
+        vertices.insert(vertices.end(), &mesh.vertices[v], &mesh.vertices[v] + 3);
+        vertices.insert(vertices.end(), &mesh.vertices[v] + 6, &mesh.vertices[v] + 8);
+    }
+    return vertices;
+}
+
+inline unsigned int addProceduralVertex(ProceduralMesh& mesh, const glm::vec3& position, const glm::vec3& normal, const glm::vec2& uv)
+{
+    unsigned int index = (unsigned int)(mesh.vertices.size() / PROCEDURAL_VERTEX_FLOATS);
+    if (index == 0)
+        mesh.boundsMin = mesh.boundsMax = position;
+    mesh.boundsMin = glm::min(mesh.boundsMin, position);
+    mesh.boundsMax = glm::max(mesh.boundsMax, position);
+    const float vertex[PROCEDURAL_VERTEX_FLOATS] = { position.x, position.y, position.z, normal.x, normal.y, normal.z, uv.x, uv.y };
+    mesh.vertices.insert(mesh.vertices.end(), vertex, vertex + PROCEDURAL_VERTEX_FLOATS);
+    return index;
+}
+
+// adds a triangle wound towards its vertices' normals; triangles without area
+// (where a grid row meets at a pole) are left out
+// ---------------------------------------------------------------------------
+inline void addProceduralTriangle(ProceduralMesh& mesh, unsigned int a, unsigned int b, unsigned int c)
+{
+    const float* v[3] = { &mesh.vertices[a * PROCEDURAL_VERTEX_FLOATS], &mesh.vertices[b * PROCEDURAL_VERTEX_FLOATS], &mesh.vertices[c * PROCEDURAL_VERTEX_FLOATS] };
+    glm::vec3 p0(v[0][0], v[0][1], v[0][2]), p1(v[1][0], v[1][1], v[1][2]), p2(v[2][0], v[2][1], v[2][2]);
+    glm::vec3 face = glm::cross(p1 - p0, p2 - p0);
+    if (glm::dot(face, face) < 1e-14f)
+        return;
+    glm::vec3 normal(v[0][3] + v[1][3] + v[2][3], v[0][4] + v[1][4] + v[2][4], v[0][5] + v[1][5] + v[2][5]);
+    mesh.indices.push_back(a);
+    if (glm::dot(face, normal) >= 0.0f)
+    {
+        mesh.indices.push_back(b);
+        mesh.indices.push_back(c);
+    }
+    else
+    {
+        mesh.indices.push_back(c);
+        mesh.indices.push_back(b);
+    }
+}
+
+// triangulates a grid of (columns + 1) x (rows + 1) vertices stored row by row
+// from first. the quads go out in bands a few columns wide, row by row inside
+// each band, so the vertices shared with the previous row are still in the
+// post-transform cache when they come up again
+// ---------------------------------------------------------------------------
+inline void addProceduralGrid(ProceduralMesh& mesh, unsigned int first, unsigned int columns, unsigned int rows)
+{
+    const unsigned int BAND = 8;
+    for (unsigned int band = 0; band < columns; band += BAND)
+    {
+        unsigned int bandEnd = band + BAND < columns ? band + BAND : columns;
+        for (unsigned int row = 0; row < rows; ++row)
+        {
+            for (unsigned int column = band; column < bandEnd; ++column)
+            {
+                unsigned int a = first + row * (columns + 1) + column;
+                unsigned int b = a + 1;
+                unsigned int c = a + columns + 1;
+                unsigned int d = c + 1;
+                addProceduralTriangle(mesh, a, c, b);
+                addProceduralTriangle(mesh, b, c, d);
+            }
+        }
+    }
+}
+
+// a disc in the y = height plane facing up or down, as a fan around its center
+// ---------------------------------------------------------------------------
+inline void addProceduralCap(ProceduralMesh& mesh, const std::vector<glm::vec2>& outline, float height, bool up)
+{
+    glm::vec2 low = outline[0], high = outline[0], center(0.0f);
+    for (const glm::vec2& point : outline)
+    {
+        low = glm::min(low, point);
+        high = glm::max(high, point);
+        center += point;
+    }
+    center /= (float)outline.size();
+    glm::vec2 extent = glm::max(high - low, glm::vec2(1e-6f));
+    glm::vec3 normal(0.0f, up ? 1.0f : -1.0f, 0.0f);
+    unsigned int middle = addProceduralVertex(mesh, glm::vec3(center.x, height, center.y), normal, (center - low) / extent);
+    unsigned int first = middle + 1;
+    for (const glm::vec2& point : outline)
+        addProceduralVertex(mesh, glm::vec3(point.x, height, point.y), normal, (point - low) / extent);
+    for (unsigned int i = 0; i < outline.size(); ++i)
+        addProceduralTriangle(mesh, middle, first + i, first + (i + 1) % (unsigned int)outline.size());
+}
+
+inline std::vector<glm::vec2> circleOutline(float radius, unsigned int segments)
+{
+    std::vector<glm::vec2> outline;
+    for (unsigned int i = 0; i < segments; ++i)
+    {
+        float angle = 2.0f * 3.14159265358979f * i / segments;
+        outline.push_back(glm::vec2(radius * std::cos(angle), radius * std::sin(angle)));
+    }
+    return outline;
+}
+
+// an open or capped cylinder standing on y = 0 around the y axis; u goes
+// around once, v from the bottom (0) to the top (1)
+// ---------------------------------------------------------------------------
+inline ProceduralMesh generateCylinder(float radius, float height, unsigned int segments, bool caps)
+{
+    ProceduralMesh mesh;
+    for (unsigned int row = 0; row <= 1; ++row)
+    {
+        for (unsigned int column = 0; column <= segments; ++column)
+        {
+            // the seam column is repeated so u can run from 0 to 1
+            float u = (float)column / segments;
+            float angle = 2.0f * 3.14159265358979f * u;
+            glm::vec3 normal(std::cos(angle), 0.0f, std::sin(angle));
+            addProceduralVertex(mesh, glm::vec3(radius * normal.x, height * row, radius * normal.z), normal, glm::vec2(u, (float)row));
+        }
+    }
+    addProceduralGrid(mesh, 0, segments, 1);
+    if (caps)
+    {
+        std::vector<glm::vec2> outline = circleOutline(radius, segments);
+        addProceduralCap(mesh, outline, 0.0f, false);
+        addProceduralCap(mesh, outline, height, true);
+    }
+    return mesh;
+}
+
+// the upper half of a sphere around the origin, open at the bottom; u goes
+// around once, v from the rim (0) to the pole (1)
+// ---------------------------------------------------------------------------
+inline ProceduralMesh generateDome(float radius, unsigned int segments, unsigned int rings)
+{
+    ProceduralMesh mesh;
+    for (unsigned int row = 0; row <= rings; ++row)
+    {
+        float v = (float)row / rings;
+        float elevation = 0.5f * 3.14159265358979f * v;
+        for (unsigned int column = 0; column <= segments; ++column)
+        {
+            float u = (float)column / segments;
+            float angle = 2.0f * 3.14159265358979f * u;
+            glm::vec3 normal(std::cos(angle) * std::cos(elevation), std::sin(elevation), std::sin(angle) * std::cos(elevation));
+            if (row == rings)
+                normal = glm::vec3(0.0f, 1.0f, 0.0f); // exactly the pole, not a rounding error off it
+            addProceduralVertex(mesh, normal * radius, normal, glm::vec2(u, v));
+        }
+    }
+    addProceduralGrid(mesh, 0, segments, rings);
+    return mesh;
+}
+
+// extrudes a convex outline in the xz plane from y = 0 to height. every side
+// is a flat quad with its own vertices, u along the side and v up it
+// ---------------------------------------------------------------------------
+inline ProceduralMesh generatePrism(const std::vector<glm::vec2>& outline, float height, bool caps)
+{
+    ProceduralMesh mesh;
+    glm::vec2 center(0.0f);
+    for (const glm::vec2& point : outline)
+        center += point;
+    center /= (float)outline.size();
+    for (unsigned int i = 0; i < outline.size(); ++i)
+    {
+        glm::vec2 start = outline[i];
+        glm::vec2 end = outline[(i + 1) % outline.size()];
+        glm::vec2 side = end - start;
+        glm::vec3 normal = glm::normalize(glm::vec3(side.y, 0.0f, -side.x));
+        if (glm::dot(glm::vec2(normal.x, normal.z), (start + end) * 0.5f - center) < 0.0f)
+            normal = -normal;
+        unsigned int first = addProceduralVertex(mesh, glm::vec3(start.x, 0.0f, start.y), normal, glm::vec2(0.0f, 0.0f));
+        addProceduralVertex(mesh, glm::vec3(end.x, 0.0f, end.y), normal, glm::vec2(1.0f, 0.0f));
+        addProceduralVertex(mesh, glm::vec3(start.x, height, start.y), normal, glm::vec2(0.0f, 1.0f));
+        addProceduralVertex(mesh, glm::vec3(end.x, height, end.y), normal, glm::vec2(1.0f, 1.0f));
+        addProceduralGrid(mesh, first, 1, 1);
+    }
+    if (caps)
+    {
+        addProceduralCap(mesh, outline, 0.0f, false);
+        addProceduralCap(mesh, outline, height, true);
+    }
+    return mesh;
+}
+
+// a prism over a regular polygon of the given circumradius
+// --------------------------------------------------------
+inline ProceduralMesh generateRegularPrism(unsigned int sides, float radius, float height, bool caps)
+{
+    return generatePrism(circleOutline(radius, sides), height, caps);
+}
+
+#endif
@@ -0,0 +1,261 @@
+#ifndef RENDER_QUEUE_H
+#define RENDER_QUEUE_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "instancing.h"
+#include "mesh_registry.h"
+#include "shader_cache.h"
+#include "static_geometry.h"
+
+#include <algorithm>
+#include <iostream>
+#include <map>
+#include <vector>
+
+// everything needed to issue one draw
+struct DrawItem {
+    ShaderProgram* program;
+    unsigned int texture;     // bound to unit 0
+    GLenum textureTarget;     // GL_TEXTURE_2D unless the item samples an array
+    unsigned int VAO;
+    GLenum mode;
+    bool indexed;
+    GLenum indexType;
+    DrawRange range;
+    const DrawBatch* batch;   // when set the item is a multi-draw over the batch
+    const InstanceBuffer* instances; // when set (the mesh's attached buffer) the item draws one copy per instance
+    glm::mat4 model;          // includes the mesh's positionTransform
+    glm::vec4 uvTransform;
+};
+
+// what the last flush emitted and how much it skipped
+struct RenderQueueStats {
+    unsigned int draws;
+    unsigned int instances;   // copies drawn by instanced draws
+    unsigned int programBinds;
+    unsigned int textureBinds;
+    unsigned int vertexArrayBinds;
+    unsigned int uniformUploads;
+    unsigned int redundantProgramBinds;
+    unsigned int redundantTextureBinds;
+    unsigned int redundantVertexArrayBinds;
+    unsigned int redundantUniformUploads;
+
+    unsigned int redundant() const
+    {
+        return redundantProgramBinds + redundantTextureBinds + redundantVertexArrayBinds + redundantUniformUploads;
+    }
+
+    void print(std::ostream& out) const
+    {
+        out << "render queue: " << draws << " draws (" << instances << " instances), "
+            << programBinds << " program / " << textureBinds << " texture / " << vertexArrayBinds << " VAO binds, "
+            << uniformUploads << " uniform uploads; filtered " << redundant() << " redundant changes ("
+            << redundantProgramBinds << " program, " << redundantTextureBinds << " texture, "
+            << redundantVertexArrayBinds << " VAO, " << redundantUniformUploads << " uniform)" << std::endl;
+    }
+};
+
+// helpers to describe registry meshes and static geometry ranges as draw items
+// ----------------------------------------------------------------------------
+inline DrawItem makeDrawItem(ShaderProgram* program, unsigned int texture, const RetainedMesh& mesh, const glm::mat4& model)
+{
+    DrawItem item;
+    item.program = program;
+    item.texture = texture;
+    item.textureTarget = GL_TEXTURE_2D;
+    item.VAO = mesh.VAO;
+    item.mode = mesh.mode;
+    item.indexed = mesh.EBO != 0;
+    item.indexType = mesh.indexType;
+    item.range.firstVertex = 0;
+    item.range.vertexCount = mesh.vertexCount;
+    item.range.firstIndex = 0;
+    item.range.indexCount = mesh.indexCount;
+    item.batch = NULL;
+    item.instances = mesh.instances;
+    item.model = model * mesh.positionTransform;
+    item.uvTransform = mesh.uvTransform;
+    return item;
+}
+
+inline DrawItem makeDrawItem(ShaderProgram* program, unsigned int texture, const StaticGeometry& geometry, unsigned int rangeId, const glm::mat4& model)
+{
+    DrawItem item;
+    item.program = program;
+    item.texture = texture;
+    item.textureTarget = GL_TEXTURE_2D;
+    item.VAO = geometry.VAO;
+    item.mode = GL_TRIANGLES;
+    item.indexed = true;
+    item.indexType = geometry.indexType;
+    item.range = geometry.ranges[rangeId];
+    item.batch = NULL;
+    item.instances = NULL;
+    item.model = model * geometry.positionTransform;
+    item.uvTransform = geometry.uvTransform;
+    return item;
+}
+
+inline DrawItem makeDrawItem(ShaderProgram* program, unsigned int texture, const StaticGeometry& geometry, const DrawBatch& batch, const glm::mat4& model)
+{
+    DrawItem item = makeDrawItem(program, texture, geometry, 0, model);
+    item.batch = &batch;
+    return item;
+}
+
+// collects the draws of a frame, sorts them by a packed state key
+// (program | texture | VAO) and only emits the state changes that are needed.
+// items with the same key keep their submission order. the bound state is
+// remembered across flushes until the next beginFrame().
+class RenderQueue
+{
+public:
+    RenderQueueStats stats;
+
+    RenderQueue()
+    {
+        beginFrame();
+    }
+
+    // forgets the bound state and starts counting the frame's stats
+    // ------------------------------------------------------------------------
+    void beginFrame()
+    {
+        stats = RenderQueueStats();
+        currentProgram = NULL;
+        currentTexture = 0;
+        currentVAO = 0;
+        first = true;
+        models.clear();
+        uvTransforms.clear();
+    }
+
+    void submit(const DrawItem& item)
+    {
+        items.push_back(item);
+    }
+
+    // sorts and draws every submitted item, then empties the queue. the
+    // camera matrices come from the shared Camera uniform block.
+    // ------------------------------------------------------------------------
+    void flush()
+    {
+        keyed.clear();
+        for (unsigned int i = 0; i < items.size(); ++i)
+            keyed.push_back(std::make_pair(sortKey(items[i]), i));
+        std::stable_sort(keyed.begin(), keyed.end(), compareKeys);
+
+        if (first)
+            glActiveTexture(GL_TEXTURE0);
+
+        for (unsigned int k = 0; k < keyed.size(); ++k)
+        {
+            const DrawItem& item = items[keyed[k].second];
+
+            if (first || item.program != currentProgram)
+            {
+                item.program->use();
+                stats.programBinds++;
+                currentProgram = item.program;
+            }
+            else
+                stats.redundantProgramBinds++;
+
+            if (first || item.texture != currentTexture)
+            {
+                glBindTexture(item.textureTarget, item.texture);
+                stats.textureBinds++;
+                currentTexture = item.texture;
+            }
+            else
+                stats.redundantTextureBinds++;
+
+            if (first || item.VAO != currentVAO)
+            {
+                glBindVertexArray(item.VAO);
+                stats.vertexArrayBinds++;
+                currentVAO = item.VAO;
+            }
+            else
+                stats.redundantVertexArrayBinds++;
+
+            std::map<ShaderProgram*, glm::mat4>::iterator model = models.find(item.program);
+            if (model == models.end() || model->second != item.model)
+            {
+                item.program->setMat4(item.program->modelLocation, item.model);
+                models[item.program] = item.model;
+                stats.uniformUploads++;
+            }
+            else
+                stats.redundantUniformUploads++;
+
+            if (item.program->uvTransformLocation >= 0)
+            {
+                std::map<ShaderProgram*, glm::vec4>::iterator uvTransform = uvTransforms.find(item.program);
+                if (uvTransform == uvTransforms.end() || uvTransform->second != item.uvTransform)
+                {
+                    item.program->setVec4(item.program->uvTransformLocation, item.uvTransform);
+                    uvTransforms[item.program] = item.uvTransform;
+                    stats.uniformUploads++;
+                }
+                else
+                    stats.redundantUniformUploads++;
+            }
+
+            issue(item);
+            stats.draws++;
+            stats.instances += item.instances ? item.instances->count : 0;
+            first = false;
+        }
+
+        items.clear();
+    }
+
+private:
+    std::vector<DrawItem> items;
+    ShaderProgram* currentProgram;
+    unsigned int currentTexture;
+    unsigned int currentVAO;
+    bool first;
+    // uniforms stay with the program, so remember the last values per program
+    std::map<ShaderProgram*, glm::mat4> models;
+    std::map<ShaderProgram*, glm::vec4> uvTransforms;
+    std::vector<std::pair<unsigned long long, unsigned int> > keyed;
+
+    // 16 bits program, 24 bits texture, 24 bits vertex array
+    static unsigned long long sortKey(const DrawItem& item)
+    {
+        return ((unsigned long long)(item.program->ID & 0xFFFF) << 48) |
+               ((unsigned long long)(item.texture & 0xFFFFFF) << 24) |
+               (unsigned long long)(item.VAO & 0xFFFFFF);
+    }
+
+    static bool compareKeys(const std::pair<unsigned long long, unsigned int>& a, const std::pair<unsigned long long, unsigned int>& b)
+    {
+        return a.first < b.first;
+    }
+
+    static void issue(const DrawItem& item)
+    {
+        if (item.instances)
+        {
+            // the instance attributes are part of the VAO already
+            if (item.indexed)
+                glDrawElementsInstanced(item.mode, item.range.indexCount, item.indexType, (void*)(item.range.firstIndex * indexTypeSize(item.indexType)), item.instances->count);
+            else
+                glDrawArraysInstanced(item.mode, item.range.firstVertex, item.range.vertexCount, item.instances->count);
+            setDefaultInstanceAttributes();
+        }
+        else if (item.batch)
+            glMultiDrawElements(item.mode, &item.batch->counts[0], item.indexType, &item.batch->offsets[0], (GLsizei)item.batch->counts.size());
+        else if (item.indexed)
+            glDrawElements(item.mode, item.range.indexCount, item.indexType, (void*)(item.range.firstIndex * indexTypeSize(item.indexType)));
+        else
+            glDrawArrays(item.mode, item.range.firstVertex, item.range.vertexCount);
+    }
+};
+
+#endif
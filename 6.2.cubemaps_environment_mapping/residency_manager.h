@@ -0,0 +1,372 @@
+#ifndef RESIDENCY_MANAGER_H
+#define RESIDENCY_MANAGER_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "bounds.h"
+#include "compressed_texture.h"
+#include "image_decode.h"
+#include "texture_manager.h"
+#include "thread_pool.h"
+
+#include <chrono>
+#include <future>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+// a texture the residency manager accounts for
+struct ResidentTexture {
+    unsigned int ID;
+    GLenum target;                       // GL_TEXTURE_2D, GL_TEXTURE_2D_ARRAY or GL_TEXTURE_CUBE_MAP
+    std::string path;                    // source image; empty if it can't be reduced
+    bool flip;
+    std::vector<BoundingSphere> bounds;  // where it is drawn, in world space
+    size_t bytes;                        // estimated size with the levels it has now
+    size_t fullBytes;                    // estimated size with every level
+    int width;                           // of the current top level
+    int fullWidth;
+    int droppedLevels;
+    float priority;                      // how large it is on screen this frame, 0 if not visible
+    long long lastChange;                // frame of the last reduction or restore
+    bool restoring;
+    bool dirty;                          // size has to be measured again
+};
+
+// keeps the estimated texture memory under a byte budget. every texture is
+// measured level by level (mips, array layers and cube faces included); when
+// the total is over budget the least important 2D texture, invisible ones
+// first, loses its top mip level. once there is room again, reduced textures
+// that are visible get their full image back, the most important first.
+// changes are paced (one per frame, and a texture has to wait COOLDOWN
+// frames between two of its own) so usage near the budget can't thrash.
+// a budget of 0 only measures.
+class ResidencyManager
+{
+public:
+    static const long long COOLDOWN = 120;
+    static const int MIN_SIZE = 64;  // textures are never reduced below this
+
+    size_t budget;
+    unsigned int levelsDropped;
+    unsigned int texturesRestored;
+
+    ResidencyManager(ThreadPool& pool, size_t budget)
+        : budget(budget), levelsDropped(0), texturesRestored(0), pool(pool), frame(0)
+    {
+    }
+
+    // a 2D texture loaded from path that may be reduced and reloaded
+    // ------------------------------------------------------------------------
+    void track(unsigned int ID, const std::string& path, bool flip, const std::vector<BoundingSphere>& bounds)
+    {
+        ResidentTexture texture;
+        texture.ID = ID;
+        texture.target = GL_TEXTURE_2D;
+        texture.path = path;
+        texture.flip = flip;
+        texture.bounds = bounds;
+        texture.bytes = texture.fullBytes = 0;
+        texture.width = texture.fullWidth = 0;
+        texture.droppedLevels = 0;
+        texture.priority = 1.0f;
+        texture.lastChange = -COOLDOWN;
+        texture.restoring = false;
+        texture.dirty = true;
+        textures.push_back(texture);
+    }
+
+    // a texture that counts against the budget but is never reduced
+    // ------------------------------------------------------------------------
+    void trackFixed(unsigned int ID, GLenum target)
+    {
+        track(ID, std::string(), false, std::vector<BoundingSphere>());
+        textures.back().target = target;
+    }
+
+    // the texture was replaced by another one, e.g. after a hot reload
+    void retarget(unsigned int oldID, unsigned int newID)
+    {
+        for (ResidentTexture& texture : textures)
+        {
+            if (texture.ID != oldID)
+                continue;
+            texture.ID = newID;
+            texture.dirty = true;
+        }
+    }
+
+    // textures changed behind our back (streamed in, reloaded); measure again
+    void invalidate()
+    {
+        for (ResidentTexture& texture : textures)
+            texture.dirty = true;
+    }
+
+    // ranks the textures by what the camera sees and makes at most one change
+    // ------------------------------------------------------------------------
+    void update(const glm::mat4& viewProjection, const glm::vec3& cameraPosition)
+    {
+        frame++;
+        finishRestores();
+
+        Frustum frustum(viewProjection);
+        for (ResidentTexture& texture : textures)
+        {
+            if (texture.dirty)
+                measure(texture);
+            if (texture.bounds.empty())
+                continue;
+            // angular size of the nearest visible use, 1 once the camera is inside it
+            texture.priority = 0.0f;
+            for (const BoundingSphere& sphere : texture.bounds)
+            {
+                if (!frustum.intersects(sphere))
+                    continue;
+                float distance = glm::length(sphere.center - cameraPosition);
+                float size = sphere.radius / glm::max(distance, sphere.radius);
+                texture.priority = glm::max(texture.priority, size);
+            }
+        }
+        if (budget == 0)
+            return;
+
+        size_t used = usage();
+        if (used > budget)
+        {
+            ResidentTexture* victim = NULL;
+            for (ResidentTexture& texture : textures)
+                if (reducible(texture) && (!victim || texture.priority < victim->priority))
+                    victim = &texture;
+            if (victim && dropTopLevel(*victim))
+            {
+                victim->lastChange = frame;
+                victim->dirty = true;
+                levelsDropped++;
+            }
+        }
+        else
+        {
+            ResidentTexture* best = NULL;
+            for (ResidentTexture& texture : textures)
+                if (texture.droppedLevels > 0 && !texture.restoring && texture.priority > 0.0f && frame - texture.lastChange >= COOLDOWN &&
+                    used + texture.fullBytes - texture.bytes <= budget && (!best || texture.priority > best->priority))
+                    best = &texture;
+            if (best)
+                restore(*best);
+        }
+    }
+
+    size_t usage() const
+    {
+        size_t used = 0;
+        for (const ResidentTexture& texture : textures)
+            used += texture.bytes;
+        return used;
+    }
+
+    void print(std::ostream& out) const
+    {
+        unsigned int reduced = 0;
+        for (const ResidentTexture& texture : textures)
+            if (texture.droppedLevels > 0)
+                reduced++;
+        out << std::fixed << std::setprecision(1);
+        out << "texture residency: " << usage() / (1024.0 * 1024.0) << " MB";
+        if (budget)
+            out << " of " << budget / (1024.0 * 1024.0) << " MB budget";
+        out << " in " << textures.size() << " textures, " << reduced << " reduced; "
+            << levelsDropped << " mip levels dropped, " << texturesRestored << " textures restored" << std::endl;
+        out.unsetf(std::ios::floatfield);
+    }
+
+    // waits for restores that are still decoding
+    void release()
+    {
+        for (std::pair<unsigned int, std::future<DecodedImage> >& pending : restores)
+        {
+            DecodedImage image = pending.second.get();
+            freeImage(image);
+        }
+        restores.clear();
+        textures.clear();
+    }
+
+private:
+    ThreadPool& pool;
+    long long frame;
+    std::vector<ResidentTexture> textures;
+    std::vector<std::pair<unsigned int, std::future<DecodedImage> > > restores;
+
+    bool reducible(const ResidentTexture& texture) const
+    {
+        return !texture.path.empty() && !texture.restoring && texture.width / 2 >= MIN_SIZE && frame - texture.lastChange >= COOLDOWN;
+    }
+
+    static size_t texelSize(GLint internalFormat)
+    {
+        if (internalFormat == GL_RED || internalFormat == GL_R8)
+            return 1;
+        if (internalFormat == GL_RG || internalFormat == GL_RG8)
+            return 2;
+        return 4; // RGB is padded to four bytes by most drivers
+    }
+
+    // adds up every level that is in use, for each face or layer
+    void measure(ResidentTexture& texture)
+    {
+        bool cube = texture.target == GL_TEXTURE_CUBE_MAP;
+        GLenum levelTarget = cube ? GL_TEXTURE_CUBE_MAP_POSITIVE_X : texture.target;
+        glBindTexture(texture.target, texture.ID);
+        GLint maxLevel = 1000;
+        glGetTexParameteriv(texture.target, GL_TEXTURE_MAX_LEVEL, &maxLevel);
+        // a texture that is still streaming in counts with its real size, which
+        // is allocated already; only its base level points at the placeholder
+        texture.bytes = 0;
+        texture.width = 0;
+        for (GLint level = 0; level <= maxLevel; ++level)
+        {
+            GLint width = 0, height = 0, depth = 1, compressed = 0, internalFormat = 0;
+            glGetTexLevelParameteriv(levelTarget, level, GL_TEXTURE_WIDTH, &width);
+            if (width == 0)
+                break;
+            glGetTexLevelParameteriv(levelTarget, level, GL_TEXTURE_HEIGHT, &height);
+            glGetTexLevelParameteriv(levelTarget, level, GL_TEXTURE_DEPTH, &depth);
+            glGetTexLevelParameteriv(levelTarget, level, GL_TEXTURE_COMPRESSED, &compressed);
+            glGetTexLevelParameteriv(levelTarget, level, GL_TEXTURE_INTERNAL_FORMAT, &internalFormat);
+            size_t bytes = (size_t)width * height * depth * texelSize(internalFormat);
+            if (compressed)
+            {
+                GLint size = 0; // already covers every layer of an array
+                glGetTexLevelParameteriv(levelTarget, level, GL_TEXTURE_COMPRESSED_IMAGE_SIZE, &size);
+                bytes = (size_t)size;
+            }
+            texture.bytes += bytes * (cube ? 6 : 1);
+            if (level == 0)
+                texture.width = width;
+        }
+
+        if (texture.width > texture.fullWidth)
+            texture.fullWidth = texture.width;
+        texture.droppedLevels = 0;
+        while (texture.width > 0 && (texture.width << texture.droppedLevels) < texture.fullWidth)
+            texture.droppedLevels++;
+        // every dropped level was four times the one below it
+        texture.fullBytes = texture.bytes << (2 * texture.droppedLevels);
+        texture.dirty = false;
+    }
+
+    // reads every level but the top one back and specifies each of them one
+    // level higher, which frees the top level. the read back waits for the
+    // GPU, but it only happens when the budget is exceeded
+    bool dropTopLevel(ResidentTexture& texture)
+    {
+        glBindTexture(GL_TEXTURE_2D, texture.ID);
+        GLint baseLevel = 0, maxLevel = 1000, compressed = 0, internalFormat = 0;
+        glGetTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, &baseLevel);
+        glGetTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, &maxLevel);
+        if (baseLevel != 0)
+            return false; // still streaming in
+        glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_COMPRESSED, &compressed);
+        glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_INTERNAL_FORMAT, &internalFormat);
+
+        std::vector<std::vector<unsigned char> > levels;
+        std::vector<std::pair<GLint, GLint> > sizes;
+        glPixelStorei(GL_PACK_ALIGNMENT, 4);
+        for (GLint level = 1; level <= maxLevel; ++level)
+        {
+            GLint width = 0, height = 0;
+            glGetTexLevelParameteriv(GL_TEXTURE_2D, level, GL_TEXTURE_WIDTH, &width);
+            glGetTexLevelParameteriv(GL_TEXTURE_2D, level, GL_TEXTURE_HEIGHT, &height);
+            if (width == 0)
+                break;
+            std::vector<unsigned char> pixels;
+            if (compressed)
+            {
+                GLint size = 0;
+                glGetTexLevelParameteriv(GL_TEXTURE_2D, level, GL_TEXTURE_COMPRESSED_IMAGE_SIZE, &size);
+                pixels.resize(size);
+                glGetCompressedTexImage(GL_TEXTURE_2D, level, &pixels[0]);
+            }
+            else
+            {
+                pixels.resize((size_t)width * height * 4);
+                glGetTexImage(GL_TEXTURE_2D, level, GL_RGBA, GL_UNSIGNED_BYTE, &pixels[0]);
+            }
+            levels.push_back(pixels);
+            sizes.push_back(std::make_pair(width, height));
+        }
+        if (levels.empty())
+            return false;
+
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        for (size_t level = 0; level < levels.size(); ++level)
+        {
+            if (compressed)
+                glCompressedTexImage2D(GL_TEXTURE_2D, (GLint)level, internalFormat, sizes[level].first, sizes[level].second, 0,
+                                       (GLsizei)levels[level].size(), &levels[level][0]);
+            else
+                glTexImage2D(GL_TEXTURE_2D, (GLint)level, internalFormat, sizes[level].first, sizes[level].second, 0,
+                             GL_RGBA, GL_UNSIGNED_BYTE, &levels[level][0]);
+        }
+        // the old smallest level is left over at the end of the chain
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, (GLint)levels.size() - 1);
+        return true;
+    }
+
+    // puts the full image back: a compiled file is read right away, a source
+    // image is decoded on the pool and uploaded by a later update()
+    void restore(ResidentTexture& texture)
+    {
+        DDSImage image;
+        if (readCompiledTexture(texture.path, texture.flip, image))
+        {
+            glBindTexture(GL_TEXTURE_2D, texture.ID);
+            uploadCompressedLevels(GL_TEXTURE_2D, image);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, (GLint)image.levels.size() - 1);
+            texture.lastChange = frame;
+            texture.dirty = true;
+            texturesRestored++;
+            return;
+        }
+        std::string path = texture.path;
+        bool flip = texture.flip;
+        restores.push_back(std::make_pair(texture.ID, pool.submit([path, flip]() { return decodeTexture(path, flip); })));
+        texture.restoring = true;
+    }
+
+    void finishRestores()
+    {
+        for (size_t i = 0; i < restores.size();)
+        {
+            if (restores[i].second.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+            {
+                ++i;
+                continue;
+            }
+            unsigned int ID = restores[i].first;
+            DecodedImage image = restores[i].second.get();
+            restores.erase(restores.begin() + i);
+            for (ResidentTexture& texture : textures)
+            {
+                if (texture.ID != ID)
+                    continue;
+                // a failed decode leaves the reduced version in place
+                if (image.data)
+                {
+                    replaceTexture(ID, image);
+                    texturesRestored++;
+                }
+                texture.restoring = false;
+                texture.lastChange = frame;
+                texture.dirty = true;
+            }
+            freeImage(image);
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,360 @@
+#ifndef SCENE_FILE_H
+#define SCENE_FILE_H
+
+#include <glad/glad.h>
+
+#include "mapped_file.h"
+#include "mesh_registry.h"
+#include "static_geometry.h"
+
+#include <cfloat>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// binary scene geometry: one interleaved float vertex buffer with its layout,
+// one index buffer (indices are absolute, ready to draw; 16-bit whenever every
+// vertex can be addressed with them) and a table of named objects with their
+// ranges and bounds. every section starts on a 16 byte boundary so the file
+// can be mapped and handed to GL as it is.
+//
+//   SceneFileHeader
+//   SceneAttributeRecord[attributeCount]
+//   SceneObjectRecord[objectCount]
+//   float[vertexCount * floatsPerVertex]
+//   unsigned short or unsigned int[indexCount]
+//
+// version 1 files have no index size and always store 32-bit indices
+const unsigned int SCENE_MAGIC = 0x454E4353; // "SCNE"
+const unsigned int SCENE_VERSION = 2;
+
+struct SceneFileHeader {
+    unsigned int magic;
+    unsigned int version;
+    unsigned int floatsPerVertex;
+    unsigned int attributeCount;
+    unsigned int vertexCount;
+    unsigned int indexCount;
+    unsigned int objectCount;
+    unsigned int indexSize; // bytes per index, 2 or 4
+    unsigned long long attributeOffset;
+    unsigned long long objectOffset;
+    unsigned long long vertexOffset;
+    unsigned long long indexOffset;
+};
+
+struct SceneAttributeRecord {
+    unsigned int index;
+    unsigned int size;   // floats
+    unsigned int offset; // floats from the start of the vertex
+    unsigned int reserved;
+};
+
+struct SceneObjectRecord {
+    char name[32];
+    unsigned int firstVertex;
+    unsigned int vertexCount;
+    unsigned int firstIndex;
+    unsigned int indexCount;
+    float boundsMin[3];
+    float boundsMax[3];
+};
+
+inline unsigned long long alignSceneOffset(unsigned long long offset)
+{
+    return (offset + 15) & ~15ULL;
+}
+
+// writes what a StaticGeometryBuilder collected, one name per range; the
+// bounds are taken from the position attribute (location 0)
+// ---------------------------------------------------------------------------
+inline bool writeSceneFile(const std::string& path, const StaticGeometryBuilder& builder, const std::vector<std::string>& names)
+{
+    const std::vector<DrawRange>& ranges = builder.rangeData();
+    const std::vector<float>& vertices = builder.vertexData();
+    const std::vector<unsigned int>& indices = builder.indexData();
+    unsigned int floatsPerVertex = builder.vertexSize();
+    if (names.size() != ranges.size())
+    {
+        std::cout << "Scene export needs one name per object" << std::endl;
+        return false;
+    }
+    unsigned int position = 0;
+    for (const VertexAttribute& attribute : builder.vertexLayout())
+        if (attribute.index == 0)
+            position = attribute.offset;
+
+    SceneFileHeader header;
+    memset(&header, 0, sizeof(header));
+    header.magic = SCENE_MAGIC;
+    header.version = SCENE_VERSION;
+    header.floatsPerVertex = floatsPerVertex;
+    header.attributeCount = (unsigned int)builder.vertexLayout().size();
+    header.vertexCount = (unsigned int)(vertices.size() / floatsPerVertex);
+    header.indexCount = (unsigned int)indices.size();
+    header.objectCount = (unsigned int)ranges.size();
+    GLenum indexType = chooseIndexType(header.vertexCount);
+    header.indexSize = (unsigned int)indexTypeSize(indexType);
+    header.attributeOffset = alignSceneOffset(sizeof(SceneFileHeader));
+    header.objectOffset = alignSceneOffset(header.attributeOffset + header.attributeCount * sizeof(SceneAttributeRecord));
+    header.vertexOffset = alignSceneOffset(header.objectOffset + header.objectCount * sizeof(SceneObjectRecord));
+    header.indexOffset = alignSceneOffset(header.vertexOffset + vertices.size() * sizeof(float));
+
+    std::vector<SceneAttributeRecord> attributes;
+    // narrowed here, once, so loading can hand the mapped indices to GL as
+    // they are
+    std::vector<unsigned short> narrowIndices;
+    if (indexType == GL_UNSIGNED_SHORT)
+        narrowIndices.assign(indices.begin(), indices.end());
+    const void* indexData = indexType == GL_UNSIGNED_SHORT ? (const void*)&narrowIndices[0] : (const void*)&indices[0];
+
+    for (const VertexAttribute& attribute : builder.vertexLayout())
+    {
+        SceneAttributeRecord record = { attribute.index, (unsigned int)attribute.size, attribute.offset, 0 };
+        attributes.push_back(record);
+    }
+    std::vector<SceneObjectRecord> objects(ranges.size());
+    for (size_t i = 0; i < ranges.size(); ++i)
+    {
+        SceneObjectRecord& object = objects[i];
+        memset(&object, 0, sizeof(object));
+        strncpy(object.name, names[i].c_str(), sizeof(object.name) - 1);
+        object.firstVertex = ranges[i].firstVertex;
+        object.vertexCount = ranges[i].vertexCount;
+        object.firstIndex = ranges[i].firstIndex;
+        object.indexCount = ranges[i].indexCount;
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            object.boundsMin[axis] = FLT_MAX;
+            object.boundsMax[axis] = -FLT_MAX;
+        }
+        for (unsigned int v = object.firstVertex; v < object.firstVertex + object.vertexCount; ++v)
+        {
+            for (int axis = 0; axis < 3; ++axis)
+            {
+                float value = vertices[v * floatsPerVertex + position + axis];
+                object.boundsMin[axis] = value < object.boundsMin[axis] ? value : object.boundsMin[axis];
+                object.boundsMax[axis] = value > object.boundsMax[axis] ? value : object.boundsMax[axis];
+            }
+        }
+    }
+
+    std::ofstream file(path.c_str(), std::ios::binary);
+    const char padding[16] = { 0 };
+    unsigned long long written = 0;
+    // pads up to the start of the next section, then writes it
+    auto section = [&](unsigned long long offset, const void* data, size_t size) {
+        file.write(padding, (std::streamsize)(offset - written));
+        file.write((const char*)data, (std::streamsize)size);
+        written = offset + size;
+    };
+    section(0, &header, sizeof(header));
+    section(header.attributeOffset, &attributes[0], attributes.size() * sizeof(SceneAttributeRecord));
+    section(header.objectOffset, &objects[0], objects.size() * sizeof(SceneObjectRecord));
+    section(header.vertexOffset, &vertices[0], vertices.size() * sizeof(float));
+    section(header.indexOffset, indexData, indices.size() * header.indexSize);
+    if (!file)
+    {
+        std::cout << "Failed to write scene file: " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// a scene file mapped into memory. nothing is copied: the vertices and the
+// indices, in the type they are stored in, go from the mapping straight to
+// glBufferData, so only the pages GL actually reads are ever loaded from disk
+class SceneFile
+{
+public:
+    SceneFile() : header(NULL), attributes(NULL), objects(NULL), indexSize(0)
+    {
+    }
+
+    // maps and validates the file; false if it is missing, not a scene file or
+    // not laid out the way the renderer draws it (see hasExpectedLayout())
+    // ------------------------------------------------------------------------
+    bool open(const std::string& path)
+    {
+        close();
+        if (!file.open(path.c_str()))
+        {
+            std::cout << "Failed to open scene file: " << path << std::endl;
+            return false;
+        }
+        const SceneFileHeader* candidate = (const SceneFileHeader*)file.data;
+        bool known = file.size >= sizeof(SceneFileHeader) && candidate->magic == SCENE_MAGIC && (candidate->version == 1 || candidate->version == SCENE_VERSION);
+        indexSize = known && candidate->version == 1 ? sizeof(unsigned int) : known ? candidate->indexSize : 0;
+        if (!known || (indexSize != sizeof(unsigned short) && indexSize != sizeof(unsigned int)) ||
+            candidate->floatsPerVertex == 0 ||
+            !fits(candidate->attributeOffset, (unsigned long long)candidate->attributeCount * sizeof(SceneAttributeRecord)) ||
+            !fits(candidate->objectOffset, (unsigned long long)candidate->objectCount * sizeof(SceneObjectRecord)) ||
+            !fits(candidate->vertexOffset, (unsigned long long)candidate->vertexCount * candidate->floatsPerVertex * sizeof(float)) ||
+            !fits(candidate->indexOffset, (unsigned long long)candidate->indexCount * indexSize))
+        {
+            std::cout << "Not a valid scene file: " << path << std::endl;
+            close();
+            return false;
+        }
+        header = candidate;
+        attributes = (const SceneAttributeRecord*)(file.data + header->attributeOffset);
+        objects = (const SceneObjectRecord*)(file.data + header->objectOffset);
+        for (unsigned int i = 0; i < header->objectCount; ++i)
+        {
+            const SceneObjectRecord& object = objects[i];
+            if ((unsigned long long)object.firstVertex + object.vertexCount > header->vertexCount ||
+                (unsigned long long)object.firstIndex + object.indexCount > header->indexCount)
+            {
+                std::cout << "Scene object " << i << " is out of range in " << path << std::endl;
+                close();
+                return false;
+            }
+            // indices are absolute but must stay inside their own object,
+            // which is what the layered copy in the demo relies on
+            for (unsigned int j = object.firstIndex; j < object.firstIndex + object.indexCount; ++j)
+            {
+                unsigned int vertex = index(j);
+                if (vertex < object.firstVertex || vertex - object.firstVertex >= object.vertexCount)
+                {
+                    std::cout << "Scene object " << i << " has an index out of range in " << path << std::endl;
+                    close();
+                    return false;
+                }
+            }
+        }
+        if (!hasExpectedLayout())
+        {
+            std::cout << "Scene file " << path << " is not laid out as position (3 floats) + uv (2 floats)" << std::endl;
+            close();
+            return false;
+        }
+        return true;
+    }
+
+    bool isOpen() const
+    {
+        return header != NULL;
+    }
+
+    unsigned int vertexSize() const
+    {
+        return header->floatsPerVertex;
+    }
+
+    const float* vertices() const
+    {
+        return (const float*)(file.data + header->vertexOffset);
+    }
+
+    GLenum indexType() const
+    {
+        return indexSize == sizeof(unsigned short) ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+    }
+
+    // index i, whichever size it is stored in
+    // ------------------------------------------------------------------------
+    unsigned int index(size_t i) const
+    {
+        const unsigned char* indices = file.data + header->indexOffset;
+        if (indexSize == sizeof(unsigned short))
+            return ((const unsigned short*)indices)[i];
+        return ((const unsigned int*)indices)[i];
+    }
+
+    unsigned int objectCount() const
+    {
+        return header->objectCount;
+    }
+
+    const SceneObjectRecord& object(unsigned int i) const
+    {
+        return objects[i];
+    }
+
+    // the object with the given name, NULL if the file has none
+    // ------------------------------------------------------------------------
+    const SceneObjectRecord* find(const char* name) const
+    {
+        for (unsigned int i = 0; i < header->objectCount; ++i)
+            if (strncmp(objects[i].name, name, sizeof(objects[i].name)) == 0)
+                return &objects[i];
+        return NULL;
+    }
+
+    // uploads the whole file as one StaticGeometry. range i of the result is
+    // the object called names[i], so callers can keep their own object ids;
+    // false if one of the names is missing
+    // ------------------------------------------------------------------------
+    bool upload(const char* const* names, unsigned int count, StaticGeometry& geometry) const
+    {
+        std::vector<DrawRange> ranges;
+        for (unsigned int i = 0; i < count; ++i)
+        {
+            const SceneObjectRecord* object = find(names[i]);
+            if (!object)
+            {
+                std::cout << "Scene file has no object called " << names[i] << std::endl;
+                return false;
+            }
+            DrawRange range = { object->firstVertex, object->vertexCount, object->firstIndex, object->indexCount };
+            ranges.push_back(range);
+        }
+        std::vector<VertexAttribute> layout;
+        for (unsigned int i = 0; i < header->attributeCount; ++i)
+        {
+            VertexAttribute attribute = { attributes[i].index, (int)attributes[i].size, attributes[i].offset };
+            layout.push_back(attribute);
+        }
+        geometry = createStaticGeometry(vertices(), (size_t)header->vertexCount * header->floatsPerVertex * sizeof(float),
+                                        file.data + header->indexOffset, indexType(), header->indexCount, header->floatsPerVertex, layout, ranges);
+        return true;
+    }
+
+    void close()
+    {
+        file.close();
+        header = NULL;
+        attributes = NULL;
+        objects = NULL;
+    }
+
+private:
+    MappedFile file;
+    const SceneFileHeader* header;
+    const SceneAttributeRecord* attributes;
+    const SceneObjectRecord* objects;
+    unsigned int indexSize;
+
+    // every attribute inside the vertex, and exactly the position at offset 0
+    // and the uv at offset 3 of a 5 float vertex, as the demo's shaders and
+    // its layered copy of the environment read it
+    bool hasExpectedLayout() const
+    {
+        if (header->floatsPerVertex != 5 || header->attributeCount != 2)
+            return false;
+        bool position = false, uv = false;
+        for (unsigned int i = 0; i < header->attributeCount; ++i)
+        {
+            const SceneAttributeRecord& attribute = attributes[i];
+            if ((unsigned long long)attribute.offset + attribute.size > header->floatsPerVertex)
+                return false;
+            if (attribute.index == 0 && attribute.offset == 0 && attribute.size == 3)
+                position = true;
+            else if (attribute.index == 1 && attribute.offset == 3 && attribute.size == 2)
+                uv = true;
+            else
+                return false;
+        }
+        return position && uv;
+    }
+
+    // true if [offset, offset + size) is inside the file and aligned
+    bool fits(unsigned long long offset, unsigned long long size) const
+    {
+        return offset % 16 == 0 && offset <= file.size && size <= file.size - offset;
+    }
+};
+
+#endif
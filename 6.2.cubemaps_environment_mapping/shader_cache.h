@@ -0,0 +1,434 @@
+#ifndef SHADER_CACHE_H
+#define SHADER_CACHE_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include "asset_bundle.h"
+#include "fnv_hash.h"
+
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <direct.h>
+#endif
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// program binaries are GL 4.1 / ARB_get_program_binary, an extension to the
+// 3.3 core profile; without it every program is compiled from source
+inline bool supportsProgramBinaries()
+{
+#ifdef GL_ARB_get_program_binary
+    static int supported = -1;
+    if (supported < 0)
+    {
+        GLint formats = 0;
+        if (GLAD_GL_ARB_get_program_binary)
+            glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+        supported = formats > 0;
+    }
+    return supported != 0;
+#else
+    return false;
+#endif
+}
+
+// the header of a cached program binary file
+struct ProgramBinaryHeader {
+    unsigned int magic;   // "PBIN"
+    unsigned int format;  // as reported by glGetProgramBinary
+    unsigned int size;
+};
+
+const unsigned int PROGRAM_BINARY_MAGIC = 0x4E494250;
+
+// a linked program together with every uniform location, resolved once
+// right after linking so nothing has to call glGetUniformLocation per frame
+class ShaderProgram
+{
+public:
+    unsigned int ID;
+    // locations of the transform uniforms most programs share, -1 if unused
+    int modelLocation;
+    int viewLocation;
+    int projectionLocation;
+    int uvTransformLocation;  // uv scale and offset of quantized meshes
+
+    std::string vertexPath;
+    std::string fragmentPath;
+    bool fromBinary;  // the last build was loaded from the binary cache
+
+    // compiles and links the program from a vertex and fragment shader file.
+    // with a binaryCache directory the linked program is stored there and
+    // loaded back instead of compiled the next time the sources are the same
+    // ------------------------------------------------------------------------
+    ShaderProgram(const char* vertexPath, const char* fragmentPath, const std::string& binaryCache = std::string())
+        : vertexPath(vertexPath), fragmentPath(fragmentPath), fromBinary(false), binaryCache(binaryCache)
+    {
+        build(ID);
+        resolveUniforms();
+    }
+
+    // rebuilds the program from its files. the new program only replaces the
+    // current one if it compiles and links; otherwise the last good version
+    // stays in use and false is returned. the ID changes, so anything set on
+    // the old program (uniform values, block bindings) has to be set again
+    // ------------------------------------------------------------------------
+    bool reload()
+    {
+        unsigned int program = 0;
+        if (!build(program))
+        {
+            glDeleteProgram(program);
+            std::cout << "Keeping the previous version of " << vertexPath << " + " << fragmentPath << std::endl;
+            return false;
+        }
+        glDeleteProgram(ID);
+        ID = program;
+        uniforms.clear();
+        resolveUniforms();
+        return true;
+    }
+
+    bool usesFile(const std::string& path) const
+    {
+        return path == vertexPath || path == fragmentPath;
+    }
+
+    void use() const
+    {
+        glUseProgram(ID);
+    }
+
+    // location of a uniform from the table built at link time, -1 if unknown
+    // ------------------------------------------------------------------------
+    int uniform(const std::string& name) const
+    {
+        std::map<std::string, int>::const_iterator it = uniforms.find(name);
+        return it == uniforms.end() ? -1 : it->second;
+    }
+
+    // setters taking a cached location, for use inside the render loop
+    // ------------------------------------------------------------------------
+    void setInt(int location, int value) const
+    {
+        glUniform1i(location, value);
+    }
+    void setFloat(int location, float value) const
+    {
+        glUniform1f(location, value);
+    }
+    void setVec3(int location, const glm::vec3& value) const
+    {
+        glUniform3fv(location, 1, &value[0]);
+    }
+    void setVec4(int location, const glm::vec4& value) const
+    {
+        glUniform4fv(location, 1, &value[0]);
+    }
+    void setMat4(int location, const glm::mat4& mat) const
+    {
+        glUniformMatrix4fv(location, 1, GL_FALSE, glm::value_ptr(mat));
+    }
+
+    // by-name setters for one-off configuration outside the render loop
+    // ------------------------------------------------------------------------
+    void setInt(const std::string& name, int value) const
+    {
+        setInt(uniform(name), value);
+    }
+    void setFloat(const std::string& name, float value) const
+    {
+        setFloat(uniform(name), value);
+    }
+    void setVec3(const std::string& name, const glm::vec3& value) const
+    {
+        setVec3(uniform(name), value);
+    }
+    void setVec4(const std::string& name, const glm::vec4& value) const
+    {
+        setVec4(uniform(name), value);
+    }
+    void setMat4(const std::string& name, const glm::mat4& mat) const
+    {
+        setMat4(uniform(name), mat);
+    }
+
+private:
+    std::map<std::string, int> uniforms;
+    std::string binaryCache;
+
+    // loads the cached binary of the current sources, or compiles and links
+    // both stages into program; false if any step failed
+    // ------------------------------------------------------------------------
+    bool build(unsigned int& program)
+    {
+        std::string vertexCode = readFile(vertexPath.c_str());
+        std::string fragmentCode = readFile(fragmentPath.c_str());
+        std::string binaryPath = binaryCache.empty() || !supportsProgramBinaries() ? std::string() : binaryFile(vertexCode, fragmentCode);
+        fromBinary = !binaryPath.empty() && loadBinary(binaryPath, program);
+        if (fromBinary)
+            return true;
+
+        const char* vShaderCode = vertexCode.c_str();
+        const char* fShaderCode = fragmentCode.c_str();
+        unsigned int vertex = glCreateShader(GL_VERTEX_SHADER);
+        glShaderSource(vertex, 1, &vShaderCode, NULL);
+        glCompileShader(vertex);
+        bool ok = checkCompileErrors(vertex, "VERTEX");
+        unsigned int fragment = glCreateShader(GL_FRAGMENT_SHADER);
+        glShaderSource(fragment, 1, &fShaderCode, NULL);
+        glCompileShader(fragment);
+        ok = checkCompileErrors(fragment, "FRAGMENT") && ok;
+        program = glCreateProgram();
+        glAttachShader(program, vertex);
+        glAttachShader(program, fragment);
+#ifdef GL_ARB_get_program_binary
+        if (!binaryPath.empty())
+            glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+#endif
+        glLinkProgram(program);
+        ok = checkCompileErrors(program, "PROGRAM") && ok;
+        glDeleteShader(vertex);
+        glDeleteShader(fragment);
+        ok = ok && !vertexCode.empty() && !fragmentCode.empty();
+        if (ok && !binaryPath.empty())
+            saveBinary(binaryPath, program);
+        return ok;
+    }
+
+    // a binary is only valid for the exact sources and the exact driver, so
+    // both go into the file name
+    // ------------------------------------------------------------------------
+    std::string binaryFile(const std::string& vertexCode, const std::string& fragmentCode) const
+    {
+        const char* driver[] = { (const char*)glGetString(GL_VENDOR), (const char*)glGetString(GL_RENDERER), (const char*)glGetString(GL_VERSION) };
+        unsigned long long hash = fnv1a64((const unsigned char*)vertexCode.c_str(), vertexCode.size() + 1);
+        hash = fnv1a64((const unsigned char*)fragmentCode.c_str(), fragmentCode.size() + 1, hash);
+        for (const char* name : driver)
+            if (name)
+                hash = fnv1a64((const unsigned char*)name, std::string(name).size() + 1, hash);
+        char fileName[32];
+        snprintf(fileName, sizeof(fileName), "%016llx.bin", hash);
+        return binaryCache + "/" + fileName;
+    }
+
+    // creates program from a cached binary; false (and no program) if there is
+    // none or the driver rejects it, e.g. after an update
+    // ------------------------------------------------------------------------
+    bool loadBinary(const std::string& path, unsigned int& program)
+    {
+#ifdef GL_ARB_get_program_binary
+        std::ifstream file(path.c_str(), std::ios::binary);
+        ProgramBinaryHeader header;
+        if (!file || !file.read((char*)&header, sizeof(header)) || header.magic != PROGRAM_BINARY_MAGIC || header.size == 0)
+            return false;
+        std::vector<char> binary(header.size);
+        if (!file.read(&binary[0], binary.size()))
+            return false;
+        program = glCreateProgram();
+        glProgramBinary(program, header.format, &binary[0], (GLsizei)binary.size());
+        GLint success = 0;
+        glGetProgramiv(program, GL_LINK_STATUS, &success);
+        if (success)
+            return true;
+        glDeleteProgram(program);
+        program = 0;
+#else
+        (void)path;
+        (void)program;
+#endif
+        return false;
+    }
+
+    void saveBinary(const std::string& path, unsigned int program) const
+    {
+#ifdef GL_ARB_get_program_binary
+        GLint length = 0;
+        glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+        if (length <= 0)
+            return;
+        std::vector<char> binary(length);
+        ProgramBinaryHeader header = { PROGRAM_BINARY_MAGIC, 0, 0 };
+        GLsizei written = 0;
+        glGetProgramBinary(program, length, &written, &header.format, &binary[0]);
+        header.size = (unsigned int)written;
+#ifdef _WIN32
+        _mkdir(binaryCache.c_str());
+#else
+        mkdir(binaryCache.c_str(), 0755);
+#endif
+        std::ofstream file(path.c_str(), std::ios::binary);
+        file.write((const char*)&header, sizeof(header));
+        file.write(&binary[0], written);
+        if (!file)
+            std::cout << "Failed to write program binary: " << path << std::endl;
+#else
+        (void)path;
+        (void)program;
+#endif
+    }
+
+    std::string readFile(const char* path)
+    {
+        AssetSpan asset = findAsset(path);
+        if (asset.data)
+            return std::string((const char*)asset.data, asset.size);
+        std::ifstream file(path);
+        if (!file)
+        {
+            std::cout << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ: " << path << std::endl;
+            return std::string();
+        }
+        std::stringstream stream;
+        stream << file.rdbuf();
+        return stream.str();
+    }
+
+    // builds the name -> location table from the program's active uniforms
+    // ------------------------------------------------------------------------
+    void resolveUniforms()
+    {
+        int count = 0;
+        glGetProgramiv(ID, GL_ACTIVE_UNIFORMS, &count);
+        char name[256];
+        for (int i = 0; i < count; ++i)
+        {
+            GLsizei length = 0;
+            GLint size = 0;
+            GLenum type = 0;
+            glGetActiveUniform(ID, (GLuint)i, sizeof(name), &length, &size, &type, name);
+            int location = glGetUniformLocation(ID, name);
+            if (location < 0)
+                continue; // uniform block members have no location
+            std::string uniformName(name, length);
+            // arrays are reported as "name[0]", also make them reachable as "name"
+            if (uniformName.size() > 3 && uniformName.compare(uniformName.size() - 3, 3, "[0]") == 0)
+                uniforms[uniformName.substr(0, uniformName.size() - 3)] = location;
+            uniforms[uniformName] = location;
+        }
+        modelLocation = uniform("model");
+        viewLocation = uniform("view");
+        projectionLocation = uniform("projection");
+        uvTransformLocation = uniform("uvTransform");
+    }
+
+    // utility function for checking shader compilation/linking errors.
+    // ------------------------------------------------------------------------
+    bool checkCompileErrors(GLuint shader, std::string type)
+    {
+        GLint success;
+        GLchar infoLog[1024];
+        if (type != "PROGRAM")
+        {
+            glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+            if (!success)
+            {
+                glGetShaderInfoLog(shader, 1024, NULL, infoLog);
+                std::cout << "ERROR::SHADER_COMPILATION_ERROR of type: " << type << "\n" << infoLog << "\n -- --------------------------------------------------- -- " << std::endl;
+            }
+        }
+        else
+        {
+            glGetProgramiv(shader, GL_LINK_STATUS, &success);
+            if (!success)
+            {
+                glGetProgramInfoLog(shader, 1024, NULL, infoLog);
+                std::cout << "ERROR::PROGRAM_LINKING_ERROR of type: " << type << "\n" << infoLog << "\n -- --------------------------------------------------- -- " << std::endl;
+            }
+        }
+        return success != 0;
+    }
+};
+
+// compiles every vertex/fragment pair once and returns the same program to
+// everyone who asks for it afterwards
+class ShaderCache
+{
+public:
+    unsigned int programsLoaded;    // from the binary cache
+    unsigned int programsCompiled;
+    double buildMilliseconds;       // spent building programs, loaded or compiled
+
+    ShaderCache() : programsLoaded(0), programsCompiled(0), buildMilliseconds(0.0)
+    {
+    }
+
+    ~ShaderCache()
+    {
+        for (std::map<std::string, ShaderProgram*>::iterator it = programs.begin(); it != programs.end(); ++it)
+            delete it->second;
+    }
+
+    // returns the program for the given source files, building it on first use
+    // ------------------------------------------------------------------------
+    ShaderProgram& get(const std::string& vertexPath, const std::string& fragmentPath)
+    {
+        std::string key = vertexPath + "|" + fragmentPath;
+        std::map<std::string, ShaderProgram*>::iterator it = programs.find(key);
+        if (it == programs.end())
+        {
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            ShaderProgram* program = new ShaderProgram(vertexPath.c_str(), fragmentPath.c_str(), binaryCache);
+            buildMilliseconds += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            if (program->fromBinary)
+                programsLoaded++;
+            else
+                programsCompiled++;
+            it = programs.insert(std::make_pair(key, program)).first;
+        }
+        return *it->second;
+    }
+
+    // keeps linked programs in directory and loads them from there on later
+    // runs; has no effect if the driver can't hand out program binaries
+    // ------------------------------------------------------------------------
+    void setBinaryCache(const std::string& directory)
+    {
+        binaryCache = directory;
+    }
+
+    void print(std::ostream& out) const
+    {
+        out << "programs: " << programsLoaded << " loaded from the binary cache, " << programsCompiled << " compiled, "
+            << buildMilliseconds << " ms" << std::endl;
+    }
+
+    // rebuilds every program that uses the changed file and returns the ones
+    // that were replaced; programs that fail to build keep their last version
+    // ------------------------------------------------------------------------
+    std::vector<ShaderProgram*> reload(const std::string& path)
+    {
+        std::vector<ShaderProgram*> reloaded;
+        for (std::map<std::string, ShaderProgram*>::iterator it = programs.begin(); it != programs.end(); ++it)
+            if (it->second->usesFile(path) && it->second->reload())
+                reloaded.push_back(it->second);
+        return reloaded;
+    }
+
+    // deletes every program; call before the context goes away
+    // ------------------------------------------------------------------------
+    void release()
+    {
+        for (std::map<std::string, ShaderProgram*>::iterator it = programs.begin(); it != programs.end(); ++it)
+        {
+            glDeleteProgram(it->second->ID);
+            delete it->second;
+        }
+        programs.clear();
+    }
+
+private:
+    std::map<std::string, ShaderProgram*> programs;
+    std::string binaryCache;
+};
+
+#endif
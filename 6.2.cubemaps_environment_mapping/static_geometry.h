@@ -0,0 +1,237 @@
+#ifndef STATIC_GEOMETRY_H
+#define STATIC_GEOMETRY_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "mesh_optimizer.h"
+#include "mesh_registry.h"
+
+#include <vector>
+
+// the part of the shared buffers that belongs to one object
+struct DrawRange {
+    unsigned int firstVertex;
+    unsigned int vertexCount;
+    unsigned int firstIndex;
+    unsigned int indexCount;
+};
+
+// a precomputed glMultiDrawElements call over several ranges
+struct DrawBatch {
+    std::vector<GLsizei> counts;
+    std::vector<const void*> offsets;
+};
+
+// every static object packed into one vertex buffer and one index buffer
+class StaticGeometry
+{
+public:
+    unsigned int VAO;
+    unsigned int VBO;
+    unsigned int EBO;
+    GLenum indexType; // 16-bit when the vertices allow it
+    glm::mat4 positionTransform; // identity unless the vertices are quantized
+    glm::vec4 uvTransform;
+    std::vector<DrawRange> ranges;
+
+    StaticGeometry() : VAO(0), VBO(0), EBO(0), indexType(GL_UNSIGNED_INT), positionTransform(1.0f), uvTransform(1.0f, 1.0f, 0.0f, 0.0f)
+    {
+    }
+
+    // groups ranges into one multi-draw; ranges that follow each other in the
+    // buffer are merged into a single sub-draw
+    // ------------------------------------------------------------------------
+    DrawBatch makeBatch(const std::vector<unsigned int>& rangeIds) const
+    {
+        DrawBatch batch;
+        unsigned int end = 0;
+        for (unsigned int id : rangeIds)
+        {
+            const DrawRange& range = ranges[id];
+            if (!batch.counts.empty() && range.firstIndex == end)
+                batch.counts.back() += range.indexCount;
+            else
+            {
+                batch.counts.push_back(range.indexCount);
+                batch.offsets.push_back((const void*)(range.firstIndex * indexTypeSize(indexType)));
+            }
+            end = range.firstIndex + range.indexCount;
+        }
+        return batch;
+    }
+
+    // draws every range of the batch with a single call
+    // ------------------------------------------------------------------------
+    void draw(const DrawBatch& batch) const
+    {
+        glBindVertexArray(VAO);
+        glMultiDrawElements(GL_TRIANGLES, &batch.counts[0], indexType, &batch.offsets[0], (GLsizei)batch.counts.size());
+    }
+
+    void draw(unsigned int rangeId) const
+    {
+        const DrawRange& range = ranges[rangeId];
+        glBindVertexArray(VAO);
+        glDrawElements(GL_TRIANGLES, range.indexCount, indexType, (void*)(range.firstIndex * indexTypeSize(indexType)));
+    }
+
+    void release()
+    {
+        glDeleteVertexArrays(1, &VAO);
+        glDeleteBuffers(1, &VBO);
+        glDeleteBuffers(1, &EBO);
+        VAO = VBO = EBO = 0;
+    }
+};
+
+// uploads interleaved float vertices and indices stored in indexType as one
+// StaticGeometry, quantizing the vertices if quantizeVerticesOnLoad() is set.
+// 16-bit indices go to GL as they are; 32-bit ones are narrowed on the way
+// when they fit (see uploadIndices()). the data can come from anywhere, e.g.
+// straight out of a mapped scene file
+// ---------------------------------------------------------------------------
+inline StaticGeometry createStaticGeometry(const float* vertices, size_t vertexBytes, const void* indices, GLenum indexType, size_t indexCount,
+                                           unsigned int floatsPerVertex, const std::vector<VertexAttribute>& attributes,
+                                           const std::vector<DrawRange>& ranges)
+{
+    StaticGeometry geometry;
+    geometry.ranges = ranges;
+
+    glGenVertexArrays(1, &geometry.VAO);
+    glGenBuffers(1, &geometry.VBO);
+    glGenBuffers(1, &geometry.EBO);
+    glBindVertexArray(geometry.VAO);
+    glBindBuffer(GL_ARRAY_BUFFER, geometry.VBO);
+    unsigned int vertexCount = static_cast<unsigned int>(vertexBytes / (floatsPerVertex * sizeof(float)));
+    QuantizedVertices quantized;
+    if (quantizeVerticesOnLoad() && quantizeVertices(vertices, vertexCount, floatsPerVertex, attributes, quantized))
+    {
+        glBufferData(GL_ARRAY_BUFFER, quantized.data.size() * sizeof(unsigned short), &quantized.data[0], GL_STATIC_DRAW);
+        setVertexAttributes(quantized.attributes, quantized.stride);
+        geometry.positionTransform = quantized.positionTransform();
+        geometry.uvTransform = quantized.uvTransform();
+    }
+    else
+    {
+        glBufferData(GL_ARRAY_BUFFER, vertexBytes, vertices, GL_STATIC_DRAW);
+        setVertexAttributes(attributes, floatsPerVertex);
+    }
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, geometry.EBO);
+    if (indexType == GL_UNSIGNED_INT)
+    {
+        geometry.indexType = chooseIndexType(vertexCount);
+        uploadIndices((const unsigned int*)indices, indexCount, geometry.indexType);
+    }
+    else
+    {
+        geometry.indexType = indexType;
+        uploadIndices(indices, indexCount, indexType);
+    }
+    glBindVertexArray(0);
+    return geometry;
+}
+
+inline StaticGeometry createStaticGeometry(const float* vertices, size_t vertexBytes, const unsigned int* indices, size_t indexCount,
+                                           unsigned int floatsPerVertex, const std::vector<VertexAttribute>& attributes,
+                                           const std::vector<DrawRange>& ranges)
+{
+    return createStaticGeometry(vertices, vertexBytes, (const void*)indices, GL_UNSIGNED_INT, indexCount, floatsPerVertex, attributes, ranges);
+}
+
+// collects the vertex arrays of static objects that share one vertex layout
+// and packs them into a StaticGeometry
+class StaticGeometryBuilder
+{
+public:
+    StaticGeometryBuilder(unsigned int floatsPerVertex, const std::vector<VertexAttribute>& attributes)
+        : floatsPerVertex(floatsPerVertex), attributes(attributes)
+    {
+    }
+
+    // appends a non-indexed triangle list and returns the id of its range;
+    // its identical vertices are welded, see addIndexed()
+    // ------------------------------------------------------------------------
+    unsigned int add(const float* data, size_t sizeInBytes)
+    {
+        return addIndexed(data, sizeInBytes, NULL, 0);
+    }
+
+    // appends an indexed triangle list; indices are relative to the object's
+    // first vertex and get rebased into the shared buffer. the object goes
+    // through optimizeMesh() first, for the vertex cache, overdraw and fetch
+    // ------------------------------------------------------------------------
+    unsigned int addIndexed(const float* data, size_t sizeInBytes, const unsigned int* objectIndices, unsigned int indexCount)
+    {
+        OptimizedMesh mesh;
+        unsigned int position = 0;
+        for (const VertexAttribute& attribute : attributes)
+            if (attribute.index == 0)
+                position = attribute.offset;
+        reports.push_back(optimizeMesh(data, static_cast<unsigned int>(sizeInBytes / (floatsPerVertex * sizeof(float))), floatsPerVertex,
+                                       objectIndices, indexCount, mesh, position));
+
+        DrawRange range;
+        range.firstVertex = static_cast<unsigned int>(vertices.size() / floatsPerVertex);
+        range.vertexCount = static_cast<unsigned int>(mesh.vertices.size() / floatsPerVertex);
+        range.firstIndex = static_cast<unsigned int>(indices.size());
+        range.indexCount = static_cast<unsigned int>(mesh.indices.size());
+
+        vertices.insert(vertices.end(), mesh.vertices.begin(), mesh.vertices.end());
+        for (unsigned int index : mesh.indices)
+            indices.push_back(range.firstVertex + index);
+
+        ranges.push_back(range);
+        return static_cast<unsigned int>(ranges.size() - 1);
+    }
+
+    // uploads everything that was added so far
+    // ------------------------------------------------------------------------
+    StaticGeometry build() const
+    {
+        return createStaticGeometry(&vertices[0], vertices.size() * sizeof(float), &indices[0], indices.size(), floatsPerVertex, attributes, ranges);
+    }
+
+    // what has been collected, e.g. for exporting it to a scene file
+    // ------------------------------------------------------------------------
+    unsigned int vertexSize() const
+    {
+        return floatsPerVertex;
+    }
+
+    const std::vector<VertexAttribute>& vertexLayout() const
+    {
+        return attributes;
+    }
+
+    const std::vector<float>& vertexData() const
+    {
+        return vertices;
+    }
+
+    const std::vector<unsigned int>& indexData() const
+    {
+        return indices;
+    }
+
+    const std::vector<DrawRange>& rangeData() const
+    {
+        return ranges;
+    }
+
+    // what optimizeMesh() did to each object, in the order they were added
+    const std::vector<MeshOptimizationReport>& optimizationReports() const
+    {
+        return reports;
+    }
+
+private:
+    unsigned int floatsPerVertex;
+    std::vector<VertexAttribute> attributes;
+    std::vector<float> vertices;
+    std::vector<unsigned int> indices;
+    std::vector<DrawRange> ranges;
+    std::vector<MeshOptimizationReport> reports;
+};
+
+#endif
@@ -0,0 +1,205 @@
+// offline texture compiler: converts every PNG / JPEG below a directory into a
+// DDS file next to it (<image>.dds) holding BC1 blocks, or BC3 when the image
+// has transparency, with a complete box-filtered mip chain. the renderer
+// prefers these files over the source images (see compressed_texture.h).
+//
+// usage: texture_compiler <textures dir> [--force] [--flip <name>]...
+//   --force        rebuild files that are newer than their source
+//   --flip <name>  store the image bottom-up, for textures the renderer loads
+//                  flipped (mosaic.jpg, dome1.png, in.jpg)
+//        texture_compiler --cubemap <out.dds> <+x> <-x> <+y> <-y> <+z> <-z>
+//   packs six equally sized faces into one cube DDS for loadCubemap2
+//
+// it is its own executable next to the chapter, linked against stb_image
+// only, e.g.
+//   g++ -std=c++17 -O2 -I<includes> texture_compiler.cpp stb_image.cpp -pthread -o texture_compiler
+#include <stb_image.h>
+
+#include "bc_compress.h"
+#include "dds_file.h"
+#include "image_decode.h"
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <future>
+#include <iostream>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+struct CompileResult {
+    std::string path;
+    bool ok;
+    size_t sourceBytes;   // uncompressed RGBA with mips, what the runtime used to upload
+    size_t compiledBytes;
+};
+
+bool hasAlpha(const DecodedImage& image)
+{
+    for (size_t i = 3; i < (size_t)image.width * image.height * 4; i += 4)
+        if (image.data[i] != 255)
+            return true;
+    return false;
+}
+
+// appends the compressed mip chain of one RGBA image (one face) to dds;
+// returns the bytes the uncompressed chain would have taken
+// -----------------------------------------------------------------------
+size_t appendMipChain(DDSImage& dds, const DecodedImage& image)
+{
+    bool firstFace = dds.levels.empty() || dds.data.size() < dds.faceSize();
+    size_t faceStart = dds.data.size();
+    size_t uncompressed = 0;
+    std::vector<unsigned char> level(image.data, image.data + (size_t)image.width * image.height * 4);
+    int width = image.width, height = image.height;
+    for (;;)
+    {
+        std::vector<unsigned char> blocks = compressImage(&level[0], width, height, dds.fourCC == DDS_DXT5);
+        if (firstFace)
+        {
+            DDSLevel info = { width, height, dds.data.size() - faceStart, blocks.size() };
+            dds.levels.push_back(info);
+        }
+        dds.data.insert(dds.data.end(), blocks.begin(), blocks.end());
+        uncompressed += level.size();
+        if (width == 1 && height == 1)
+            break;
+        level = downsampleRGBA(&level[0], width, height, width, height);
+    }
+    return uncompressed;
+}
+
+// decodes one image, builds its mip chain and writes the compressed container
+// ---------------------------------------------------------------------------
+CompileResult compileTexture(const fs::path& source, const fs::path& target, bool flip)
+{
+    CompileResult result = { source.string(), false, 0, 0 };
+    DecodedImage image = decodeImage(source.string(), 4, flip);
+    if (!image.data)
+    {
+        std::cout << "Texture failed to load at path: " << source.string() << std::endl;
+        return result;
+    }
+
+    DDSImage dds;
+    dds.width = image.width;
+    dds.height = image.height;
+    dds.fourCC = hasAlpha(image) ? DDS_DXT5 : DDS_DXT1;
+    dds.flipped = flip;
+    dds.faces = 1;
+    result.sourceBytes = appendMipChain(dds, image);
+    freeImage(image);
+
+    result.ok = writeDDS(target.string(), dds);
+    result.compiledBytes = dds.data.size();
+    if (!result.ok)
+        std::cout << "Failed to write " << target.string() << std::endl;
+    return result;
+}
+
+// packs six faces into one cube container
+// ----------------------------------------
+int compileCubemap(const std::string& target, char* faces[6])
+{
+    ThreadPool pool;
+    std::vector<std::future<DecodedImage> > decoded;
+    for (int face = 0; face < 6; ++face)
+    {
+        std::string path = faces[face];
+        decoded.push_back(pool.submit([path]() { return decodeImage(path, 4, false); }));
+    }
+    std::vector<DecodedImage> images;
+    for (std::future<DecodedImage>& face : decoded)
+        images.push_back(face.get());
+
+    DDSImage dds;
+    dds.width = images[0].width;
+    dds.height = images[0].height;
+    dds.fourCC = DDS_DXT1;
+    dds.flipped = false;
+    dds.faces = 6;
+    bool ok = true;
+    for (DecodedImage& image : images)
+    {
+        if (!image.data || image.width != dds.width || image.height != dds.height || image.width != image.height)
+        {
+            std::cout << "Cubemap face is missing or not " << dds.width << "x" << dds.width << ": " << image.path << std::endl;
+            ok = false;
+        }
+        else if (hasAlpha(image))
+            dds.fourCC = DDS_DXT5;
+    }
+    if (ok)
+    {
+        for (DecodedImage& image : images)
+            appendMipChain(dds, image);
+        ok = writeDDS(target, dds);
+        std::cout << target << ": " << dds.data.size() / 1024 << " KB" << std::endl;
+    }
+    for (DecodedImage& image : images)
+        freeImage(image);
+    return ok ? 0 : 1;
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc == 9 && std::string(argv[1]) == "--cubemap")
+        return compileCubemap(argv[2], argv + 3);
+    if (argc < 2)
+    {
+        std::cout << "usage: texture_compiler <textures dir> [--force] [--flip <name>]..." << std::endl;
+        std::cout << "       texture_compiler --cubemap <out.dds> <+x> <-x> <+y> <-y> <+z> <-z>" << std::endl;
+        return 1;
+    }
+    fs::path root = argv[1];
+    bool force = false;
+    std::set<std::string> flipped;
+    for (int i = 2; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg == "--force")
+            force = true;
+        else if (arg == "--flip" && i + 1 < argc)
+            flipped.insert(argv[++i]);
+    }
+
+    ThreadPool pool;
+    std::vector<std::future<CompileResult> > jobs;
+    for (const fs::directory_entry& entry : fs::recursive_directory_iterator(root))
+    {
+        if (!entry.is_regular_file())
+            continue;
+        std::string extension = entry.path().extension().string();
+        std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+        if (extension != ".png" && extension != ".jpg" && extension != ".jpeg")
+            continue;
+
+        fs::path source = entry.path();
+        fs::path target = source.string() + ".dds";
+        if (!force && fs::exists(target) && fs::last_write_time(target) >= fs::last_write_time(source))
+            continue;
+        bool flip = flipped.count(source.filename().string()) > 0;
+        jobs.push_back(pool.submit([source, target, flip]() { return compileTexture(source, target, flip); }));
+    }
+
+    size_t sourceBytes = 0, compiledBytes = 0;
+    int failed = 0;
+    for (std::future<CompileResult>& job : jobs)
+    {
+        CompileResult result = job.get();
+        if (!result.ok)
+        {
+            failed++;
+            continue;
+        }
+        sourceBytes += result.sourceBytes;
+        compiledBytes += result.compiledBytes;
+        std::cout << result.path << ": " << result.sourceBytes / 1024 << " KB -> " << result.compiledBytes / 1024 << " KB" << std::endl;
+    }
+    std::cout << jobs.size() - failed << " textures compiled, " << sourceBytes / (1024 * 1024) << " MB of RGBA mips -> "
+              << compiledBytes / (1024 * 1024) << " MB" << std::endl;
+    return failed ? 1 : 0;
+}
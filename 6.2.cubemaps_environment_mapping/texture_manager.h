@@ -0,0 +1,248 @@
+#ifndef TEXTURE_MANAGER_H
+#define TEXTURE_MANAGER_H
+
+#include <glad/glad.h>
+
+#include "image_decode.h"
+#include "texture_streamer.h"
+#include "thread_pool.h"
+
+#include <chrono>
+#include <future>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+// uploads the pixels of the bound 2D texture: the CPU built mips of a
+// decodeTexture() image, or glGenerateMipmap for images without them
+// ---------------------------------------------------------------------------
+inline void uploadImageLevels(const DecodedImage& image)
+{
+    GLenum format = image.channels == 1 ? GL_RED : image.channels == 3 ? GL_RGB : GL_RGBA;
+    glTexImage2D(GL_TEXTURE_2D, 0, format, image.width, image.height, 0, format, GL_UNSIGNED_BYTE, image.data);
+    if (image.mips.empty())
+    {
+        glGenerateMipmap(GL_TEXTURE_2D);
+        return;
+    }
+    for (size_t i = 0; i < image.mips.size(); ++i)
+    {
+        const MipLevel& level = image.mips[i];
+        glTexImage2D(GL_TEXTURE_2D, (GLint)i + 1, format, level.width, level.height, 0, format, GL_UNSIGNED_BYTE, &level.data[0]);
+    }
+}
+
+// respecifies an existing 2D texture with new pixels and mips, whatever it
+// held before (compressed levels, a streaming placeholder, fewer mips)
+// ---------------------------------------------------------------------------
+inline void replaceTexture(unsigned int textureID, const DecodedImage& image)
+{
+    glBindTexture(GL_TEXTURE_2D, textureID);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 1000);
+    uploadImageLevels(image);
+}
+
+// a texture shared between every user that asked for the same path
+struct SharedTexture {
+    unsigned int ID;
+    unsigned int refCount;
+    bool flip;   // decoded mirrored vertically, kept for reloads
+};
+
+// a texture to decode ahead of time; flip mirrors it vertically
+struct TextureRequest {
+    std::string path;
+    bool flip;
+};
+
+// decodes each texture path once and hands out the same GL texture to every
+// caller. textures are reference counted and deleted when the last user
+// releases them, or all at once by releaseAll() at shutdown.
+class TextureManager
+{
+public:
+    typedef unsigned int (*TextureLoader)(const char* path);
+    typedef unsigned int (*TextureUploader)(const DecodedImage& image);
+    typedef unsigned int (*CompiledLoader)(const std::string& path, bool flip);
+
+    // the loader does the actual decode + upload, e.g. loadTexture()
+    // ------------------------------------------------------------------------
+    TextureManager(TextureLoader loader) : loader(loader), streamer(NULL)
+    {
+    }
+
+    // returns the texture for path, loading it on first use
+    // ------------------------------------------------------------------------
+    unsigned int acquire(const std::string& path)
+    {
+        std::map<std::string, SharedTexture>::iterator it = textures.find(path);
+        if (it == textures.end())
+        {
+            SharedTexture texture;
+            texture.ID = loader(path.c_str());
+            texture.refCount = 0;
+            texture.flip = false;
+            it = textures.insert(std::make_pair(path, texture)).first;
+        }
+        it->second.refCount++;
+        return it->second.ID;
+    }
+
+    // decodes every requested texture that isn't loaded yet on the pool and
+    // uploads them here, on the GL thread, as they finish. later acquire()
+    // calls for these paths return the uploaded textures. textures that
+    // compiled() can load (pre-compressed files) skip the decode entirely.
+    // ------------------------------------------------------------------------
+    void preload(const std::vector<TextureRequest>& requests, ThreadPool& pool, TextureUploader upload, CompiledLoader compiled = NULL)
+    {
+        std::vector<std::future<DecodedImage> > pending;
+        std::vector<bool> flipped;
+        for (const TextureRequest& request : requests)
+        {
+            if (textures.count(request.path))
+                continue;
+            unsigned int compiledID = compiled ? compiled(request.path, request.flip) : 0;
+            if (compiledID)
+            {
+                SharedTexture texture;
+                texture.ID = compiledID;
+                texture.refCount = 0;
+                texture.flip = request.flip;
+                textures.insert(std::make_pair(request.path, texture));
+                continue;
+            }
+            std::string path = request.path;
+            bool flip = request.flip;
+            pending.push_back(pool.submit([path, flip]() { return decodeTexture(path, flip); }));
+            flipped.push_back(flip);
+        }
+        for (size_t i = 0; i < pending.size(); ++i)
+        {
+            DecodedImage image = pending[i].get();
+            if (textures.count(image.path))
+            {
+                // the same path was requested twice
+                freeImage(image);
+                continue;
+            }
+            SharedTexture texture;
+            texture.ID = upload(image);
+            texture.refCount = 0;
+            texture.flip = flipped[i];
+            textures.insert(std::make_pair(image.path, texture));
+            freeImage(image);
+        }
+    }
+
+    // like preload(), but returns at once: the textures are placeholders until
+    // the streamer has uploaded them, under the IDs acquire() already returns
+    // ------------------------------------------------------------------------
+    void stream(const std::vector<TextureRequest>& requests, TextureStreamer& streamer)
+    {
+        this->streamer = &streamer;
+        for (const TextureRequest& request : requests)
+        {
+            if (textures.count(request.path))
+                continue;
+            SharedTexture texture;
+            texture.ID = streamer.request(request.path, request.flip);
+            texture.refCount = 0;
+            texture.flip = request.flip;
+            textures.insert(std::make_pair(request.path, texture));
+        }
+    }
+
+    // decodes the file at path again on the pool if it is one of ours; the
+    // new pixels replace the old ones under the same texture ID once
+    // update() finds the decode done. a texture still streaming in stops
+    // streaming, or the stream would overwrite the reload when it lands.
+    // false if the path isn't loaded
+    // ------------------------------------------------------------------------
+    bool reload(const std::string& path, ThreadPool& pool)
+    {
+        std::map<std::string, SharedTexture>::iterator it = textures.find(path);
+        if (it == textures.end())
+            return false;
+        if (streamer)
+            streamer->cancel(it->second.ID);
+        // always the source image: a compiled file next to it is now out of date
+        bool flip = it->second.flip;
+        reloads.push_back(pool.submit([path, flip]() { return decodeTexture(path, flip); }));
+        return true;
+    }
+
+    // uploads the reloads that finished decoding; never waits for one. a file
+    // that fails to decode (e.g. caught half-written) keeps its last image
+    // ------------------------------------------------------------------------
+    unsigned int update()
+    {
+        unsigned int replaced = 0;
+        for (size_t i = 0; i < reloads.size();)
+        {
+            if (reloads[i].wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+            {
+                ++i;
+                continue;
+            }
+            DecodedImage image = reloads[i].get();
+            reloads.erase(reloads.begin() + i);
+            std::map<std::string, SharedTexture>::iterator it = textures.find(image.path);
+            if (!image.data)
+                std::cout << "Keeping the previous version of " << image.path << std::endl;
+            else if (it != textures.end())
+            {
+                replaceTexture(it->second.ID, image);
+                replaced++;
+            }
+            freeImage(image);
+        }
+        return replaced;
+    }
+
+    // drops one reference; the GL texture is deleted with the last one
+    // ------------------------------------------------------------------------
+    void release(unsigned int textureID)
+    {
+        for (std::map<std::string, SharedTexture>::iterator it = textures.begin(); it != textures.end(); ++it)
+        {
+            if (it->second.ID != textureID)
+                continue;
+            if (--it->second.refCount == 0)
+            {
+                glDeleteTextures(1, &it->second.ID);
+                textures.erase(it);
+            }
+            return;
+        }
+    }
+
+    // deletes every texture regardless of outstanding references
+    // ------------------------------------------------------------------------
+    void releaseAll()
+    {
+        for (std::future<DecodedImage>& reload : reloads)
+        {
+            DecodedImage image = reload.get();
+            freeImage(image);
+        }
+        reloads.clear();
+        for (std::map<std::string, SharedTexture>::iterator it = textures.begin(); it != textures.end(); ++it)
+            glDeleteTextures(1, &it->second.ID);
+        textures.clear();
+    }
+
+    size_t size() const
+    {
+        return textures.size();
+    }
+
+private:
+    TextureLoader loader;
+    TextureStreamer* streamer; // the one stream() handed textures to, if any
+    std::map<std::string, SharedTexture> textures;
+    std::vector<std::future<DecodedImage> > reloads;
+};
+
+#endif
@@ -0,0 +1,313 @@
+#ifndef TEXTURE_STREAMER_H
+#define TEXTURE_STREAMER_H
+
+#include <glad/glad.h>
+
+#include "compressed_texture.h"
+#include "image_decode.h"
+#include "thread_pool.h"
+
+#include <chrono>
+#include <cstring>
+#include <deque>
+#include <future>
+#include <iostream>
+#include <string>
+#include <utility>
+
+// a texture whose pixels are still on their way to the GPU
+struct StreamingTexture {
+    unsigned int ID;
+    std::future<DecodedImage> decode;
+    DecodedImage image;
+    bool decoded;
+    bool cancelled; // dropped once its decode is done, see cancel()
+    int level;     // the mip level being copied
+    int nextRow;   // of that level
+    int levels;
+};
+
+// hands out textures immediately and fills them in over the next frames.
+// a requested texture starts as a 1x1 placeholder while a worker decodes the
+// image and builds its mips (decodeTexture()); the rows of every level are
+// then copied through a small ring of pixel buffer objects, at most
+// bytesPerFrame per update(), each fenced so a buffer is only rewritten once
+// the GPU has consumed it. the placeholder stays visible (as the texture's
+// base level) until the last row has landed, then the real image and its
+// mips are switched in under the same texture name.
+class TextureStreamer
+{
+public:
+    static const unsigned int RING = 3;
+    static const size_t BUFFER_SIZE = 4 * 1024 * 1024;
+
+    TextureStreamer(ThreadPool& pool, size_t bytesPerFrame = 8 * 1024 * 1024)
+        : bytesUploaded(0), texturesCompleted(0), pool(pool), bytesPerFrame(bytesPerFrame), nextBuffer(0)
+    {
+        for (unsigned int i = 0; i < RING; ++i)
+        {
+            buffers[i] = 0;
+            fences[i] = 0;
+        }
+    }
+
+    // allocates the pixel buffer ring
+    // ------------------------------------------------------------------------
+    void create()
+    {
+        glGenBuffers(RING, buffers);
+        for (unsigned int i = 0; i < RING; ++i)
+        {
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffers[i]);
+            glBufferData(GL_PIXEL_UNPACK_BUFFER, BUFFER_SIZE, NULL, GL_STREAM_DRAW);
+        }
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    }
+
+    // returns a texture that shows a placeholder until the image has streamed
+    // in; compiled textures are small enough to load right away
+    // ------------------------------------------------------------------------
+    unsigned int request(const std::string& path, bool flip)
+    {
+        unsigned int compiled = loadCompiledTexture(path, flip);
+        if (compiled)
+            return compiled;
+
+        StreamingTexture texture;
+        glGenTextures(1, &texture.ID);
+        glBindTexture(GL_TEXTURE_2D, texture.ID);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, PLACEHOLDER);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        // always four channels so every row is tightly packed and aligned
+        texture.decode = pool.submit([path, flip]() { return decodeTexture(path, flip); });
+        texture.image.data = NULL;
+        texture.decoded = false;
+        texture.cancelled = false;
+        texture.level = 0;
+        texture.nextRow = 0;
+        texture.levels = 1;
+        pending.push_back(std::move(texture));
+        return pending.back().ID;
+    }
+
+    bool idle() const
+    {
+        return pending.empty();
+    }
+
+    // stops streaming into a texture whose pixels are about to be replaced
+    // some other way (a hot reload), so the stream can't overwrite them
+    // later. the texture keeps whatever has landed so far. a decode still
+    // running is left to finish and its image is freed without uploading;
+    // false if the texture wasn't streaming
+    // ------------------------------------------------------------------------
+    bool cancel(unsigned int textureID)
+    {
+        for (StreamingTexture& texture : pending)
+        {
+            if (texture.ID != textureID || texture.cancelled)
+                continue;
+            texture.cancelled = true;
+            return true;
+        }
+        return false;
+    }
+
+    // uploads up to bytesPerFrame of finished images; call once per frame.
+    // never blocks: unfinished decodes and busy buffers wait for a later frame
+    // ------------------------------------------------------------------------
+    void update()
+    {
+        upload(bytesPerFrame, false);
+    }
+
+    // streams everything that is left, blocking until it is all on the GPU
+    // ------------------------------------------------------------------------
+    void finish()
+    {
+        while (!idle())
+            upload(BUFFER_SIZE * RING, true);
+    }
+
+    void release()
+    {
+        for (StreamingTexture& texture : pending)
+        {
+            if (!texture.decoded)
+                texture.image = texture.decode.get();
+            freeImage(texture.image);
+        }
+        pending.clear();
+        for (unsigned int i = 0; i < RING; ++i)
+        {
+            if (fences[i])
+                glDeleteSync(fences[i]);
+            fences[i] = 0;
+        }
+        glDeleteBuffers(RING, buffers);
+    }
+
+    size_t bytesUploaded;
+    unsigned int texturesCompleted;
+
+private:
+    // mid grey, so surfaces that are still streaming read as neutral rather than black
+    static constexpr unsigned char PLACEHOLDER[4] = { 128, 128, 128, 255 };
+
+    ThreadPool& pool;
+    size_t bytesPerFrame;
+    std::deque<StreamingTexture> pending;
+    unsigned int buffers[RING];
+    GLsync fences[RING];
+    unsigned int nextBuffer;
+
+    // true once the GPU is done reading the buffer
+    bool bufferFree(unsigned int buffer, bool wait)
+    {
+        if (!fences[buffer])
+            return true;
+        GLenum status = glClientWaitSync(fences[buffer], wait ? GL_SYNC_FLUSH_COMMANDS_BIT : 0, wait ? 1000000000ULL : 0);
+        if (status == GL_TIMEOUT_EXPIRED || status == GL_WAIT_FAILED)
+            return false;
+        glDeleteSync(fences[buffer]);
+        fences[buffer] = 0;
+        return true;
+    }
+
+    static bool ready(StreamingTexture& texture)
+    {
+        return texture.decoded || texture.decode.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+    }
+
+    // sizes the real texture once the image is decoded; the placeholder moves
+    // to the smallest mip, which stays the base level until the upload is done
+    void allocate(StreamingTexture& texture)
+    {
+        texture.levels = 1 + (int)texture.image.mips.size();
+        glBindTexture(GL_TEXTURE_2D, texture.ID);
+        int width = texture.image.width, height = texture.image.height;
+        for (int level = 0; level < texture.levels; ++level)
+        {
+            const void* pixels = level == texture.levels - 1 ? PLACEHOLDER : NULL;
+            glTexImage2D(GL_TEXTURE_2D, level, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+            width = width > 1 ? width / 2 : 1;
+            height = height > 1 ? height / 2 : 1;
+        }
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, texture.levels - 1);
+    }
+
+    // the pixels of one level: the image itself or one of its CPU mips
+    static const unsigned char* levelPixels(const StreamingTexture& texture, int level, int& width, int& height)
+    {
+        if (level == 0)
+        {
+            width = texture.image.width;
+            height = texture.image.height;
+            return texture.image.data;
+        }
+        const MipLevel& mip = texture.image.mips[level - 1];
+        width = mip.width;
+        height = mip.height;
+        return &mip.data[0];
+    }
+
+    void upload(size_t budget, bool wait)
+    {
+        size_t spent = 0;
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        while (!pending.empty() && spent < budget)
+        {
+            if (!wait && !ready(pending.front()))
+            {
+                // let a texture that has finished decoding jump the queue
+                size_t next = 1;
+                while (next < pending.size() && !ready(pending[next]))
+                    next++;
+                if (next == pending.size())
+                    return;
+                std::swap(pending.front(), pending[next]);
+            }
+            StreamingTexture& texture = pending.front();
+            if (texture.cancelled)
+            {
+                if (!texture.decoded)
+                    texture.image = texture.decode.get();
+                freeImage(texture.image);
+                pending.pop_front();
+                continue;
+            }
+            if (!texture.decoded)
+            {
+                texture.image = texture.decode.get();
+                texture.decoded = true;
+                if (!texture.image.data)
+                {
+                    std::cout << "Texture failed to load at path: " << texture.image.path << std::endl;
+                    pending.pop_front();
+                    continue;
+                }
+                allocate(texture);
+            }
+
+            // copy as many rows of the current level as fit into the next
+            // buffer of the ring
+            unsigned int buffer = nextBuffer;
+            if (!bufferFree(buffer, wait))
+                return;
+            int width = 0, height = 0;
+            const unsigned char* pixels = levelPixels(texture, texture.level, width, height);
+            size_t rowSize = (size_t)width * 4;
+            int rows = (int)(BUFFER_SIZE / rowSize);
+            if (rows < 1)
+            {
+                std::cout << "Texture is too wide to stream: " << texture.image.path << std::endl;
+                freeImage(texture.image);
+                pending.pop_front();
+                continue;
+            }
+            if (rows > height - texture.nextRow)
+                rows = height - texture.nextRow;
+            size_t bytes = rowSize * rows;
+
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffers[buffer]);
+            // the fence already proved the GPU is done with this buffer
+            void* mapped = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, bytes, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+            if (mapped)
+            {
+                memcpy(mapped, pixels + rowSize * texture.nextRow, bytes);
+                glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+                glBindTexture(GL_TEXTURE_2D, texture.ID);
+                glTexSubImage2D(GL_TEXTURE_2D, texture.level, 0, texture.nextRow, width, rows, GL_RGBA, GL_UNSIGNED_BYTE, (void*)0);
+                fences[buffer] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+                nextBuffer = (nextBuffer + 1) % RING;
+                texture.nextRow += rows;
+                spent += bytes;
+                bytesUploaded += bytes;
+            }
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+            if (!mapped)
+                return;
+
+            if (texture.nextRow == height)
+            {
+                texture.level++;
+                texture.nextRow = 0;
+            }
+            if (texture.level == texture.levels)
+            {
+                // every row of every level is in, switch from the placeholder
+                // to the image
+                glBindTexture(GL_TEXTURE_2D, texture.ID);
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+                freeImage(texture.image);
+                pending.pop_front();
+                texturesCompleted++;
+            }
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,194 @@
+#ifndef VERTEX_FORMAT_H
+#define VERTEX_FORMAT_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <cmath>
+#include <vector>
+
+// describes one vertex attribute inside an interleaved float vertex buffer
+struct VertexAttribute {
+    unsigned int index;   // attribute location in the shader
+    int size;             // number of components
+    unsigned int offset;  // offset in floats from the start of a vertex
+};
+
+// one attribute of a vertex in any format, as glVertexAttribPointer reads it
+struct PackedAttribute {
+    unsigned int index;
+    int size;
+    GLenum type;
+    GLboolean normalized;
+    unsigned int offset;  // in bytes
+};
+
+// float vertices repacked into 16-bit components, attribute by location:
+//   0 position  unorm16 x3 + padding, relative to the box of all positions
+//   1 uv        unorm16 x2, relative to the range of all texture coordinates
+//   2 normal    snorm16 x2, octahedral, in the space of the stored positions
+//   3 layer     uint16 + padding, read as a float
+// positionTransform() maps the stored unit cube back to the original space
+// and is meant to be folded into the model matrix; uvTransform() is the
+// scale (xy) and offset (zw) the vertex shader applies to the uv
+struct QuantizedVertices {
+    std::vector<unsigned short> data;
+    unsigned int stride;  // in bytes
+    std::vector<PackedAttribute> attributes;
+    glm::vec3 positionMin;
+    glm::vec3 positionExtent;
+    glm::vec2 uvMin;
+    glm::vec2 uvExtent;
+
+    glm::mat4 positionTransform() const
+    {
+        return glm::scale(glm::translate(glm::mat4(1.0f), positionMin), positionExtent);
+    }
+
+    glm::vec4 uvTransform() const
+    {
+        return glm::vec4(uvExtent.x, uvExtent.y, uvMin.x, uvMin.y);
+    }
+};
+
+// whether meshes are stored quantized when they are uploaded; off by default
+// ---------------------------------------------------------------------------
+inline bool& quantizeVerticesOnLoad()
+{
+    static bool enabled = false;
+    return enabled;
+}
+
+// a unit vector folded onto the octahedron |x| + |y| + |z| = 1 and flattened
+// into the [-1, 1] square; octahedralDecode() in 6.2.cubemaps_quantized.vs
+// undoes it the same way
+// ---------------------------------------------------------------------------
+inline glm::vec2 octahedralEncode(const glm::vec3& normal)
+{
+    glm::vec3 n = normal / (std::fabs(normal.x) + std::fabs(normal.y) + std::fabs(normal.z));
+    if (n.z >= 0.0f)
+        return glm::vec2(n.x, n.y);
+    return glm::vec2((1.0f - std::fabs(n.y)) * (n.x >= 0.0f ? 1.0f : -1.0f), (1.0f - std::fabs(n.x)) * (n.y >= 0.0f ? 1.0f : -1.0f));
+}
+
+inline glm::vec3 octahedralDecode(const glm::vec2& encoded)
+{
+    glm::vec3 n(encoded.x, encoded.y, 1.0f - std::fabs(encoded.x) - std::fabs(encoded.y));
+    if (n.z < 0.0f)
+        n = glm::vec3((1.0f - std::fabs(encoded.y)) * (encoded.x >= 0.0f ? 1.0f : -1.0f), (1.0f - std::fabs(encoded.x)) * (encoded.y >= 0.0f ? 1.0f : -1.0f), n.z);
+    return glm::normalize(n);
+}
+
+inline unsigned short quantizeUnorm16(float value, float low, float extent)
+{
+    float unit = glm::clamp((value - low) / extent, 0.0f, 1.0f);
+    return (unsigned short)(unit * 65535.0f + 0.5f);
+}
+
+// GL before 4.2 reads snorm16 back as (2c + 1) / 65535, so 0 comes out a
+// hair above zero; the decoded normal is normalized anyway
+inline unsigned short quantizeSnorm16(float value)
+{
+    return (unsigned short)(short)std::floor(glm::clamp(value, -1.0f, 1.0f) * 32767.0f + 0.5f);
+}
+
+// repacks float vertices as described above. false, leaving result alone,
+// if the layout has an attribute that has no quantized form
+// ---------------------------------------------------------------------------
+inline bool quantizeVertices(const float* vertices, unsigned int vertexCount, unsigned int floatsPerVertex,
+                             const std::vector<VertexAttribute>& layout, QuantizedVertices& result)
+{
+    // where each attribute goes, in 16-bit components
+    const unsigned int slots[4] = { 4, 2, 2, 2 };
+    unsigned int targets[4] = { 0, 0, 0, 0 };
+    unsigned int sources[4] = { 0, 0, 0, 0 };
+    bool present[4] = { false, false, false, false };
+    unsigned int components = 0;
+    std::vector<PackedAttribute> attributes;
+    for (const VertexAttribute& attribute : layout)
+    {
+        if (attribute.index > 3 || attribute.size != (attribute.index == 0 || attribute.index == 2 ? 3 : attribute.index == 1 ? 2 : 1))
+            return false;
+        present[attribute.index] = true;
+        sources[attribute.index] = attribute.offset;
+        targets[attribute.index] = components;
+        PackedAttribute packed = { attribute.index, attribute.index == 2 ? 2 : attribute.size,
+                                   attribute.index == 2 ? (GLenum)GL_SHORT : (GLenum)GL_UNSIGNED_SHORT,
+                                   attribute.index == 3 ? (GLboolean)GL_FALSE : (GLboolean)GL_TRUE,
+                                   (unsigned int)(components * sizeof(unsigned short)) };
+        attributes.push_back(packed);
+        components += slots[attribute.index];
+    }
+
+    // the box of the positions and the range of the uvs
+    glm::vec3 low(0.0f), high(0.0f);
+    glm::vec2 uvLow(0.0f), uvHigh(0.0f);
+    for (unsigned int v = 0; v < vertexCount; ++v)
+    {
+        const float* vertex = vertices + (size_t)v * floatsPerVertex;
+        glm::vec3 position(vertex[sources[0]], vertex[sources[0] + 1], vertex[sources[0] + 2]);
+        glm::vec2 uv(vertex[sources[1]], vertex[sources[1] + 1]);
+        low = v ? glm::min(low, position) : position;
+        high = v ? glm::max(high, position) : position;
+        uvLow = v ? glm::min(uvLow, uv) : uv;
+        uvHigh = v ? glm::max(uvHigh, uv) : uv;
+    }
+    // a flat box still needs a non-zero scale to divide by
+    glm::vec3 extent = glm::max(high - low, glm::vec3(1e-6f));
+    glm::vec2 uvExtent = glm::max(uvHigh - uvLow, glm::vec2(1e-6f));
+
+    result.data.assign((size_t)vertexCount * components, 0);
+    for (unsigned int v = 0; v < vertexCount; ++v)
+    {
+        const float* vertex = vertices + (size_t)v * floatsPerVertex;
+        unsigned short* packed = &result.data[(size_t)v * components];
+        if (present[0])
+            for (int i = 0; i < 3; ++i)
+                packed[targets[0] + i] = quantizeUnorm16(vertex[sources[0] + i], low[i], extent[i]);
+        if (present[1])
+            for (int i = 0; i < 2; ++i)
+                packed[targets[1] + i] = quantizeUnorm16(vertex[sources[1] + i], uvLow[i], uvExtent[i]);
+        if (present[2])
+        {
+            // the normal matrix of a model that includes positionTransform
+            // divides by the extent again, so store the normal scaled by it
+            glm::vec3 normal3 = glm::vec3(vertex[sources[2]], vertex[sources[2] + 1], vertex[sources[2] + 2]) * extent;
+            glm::vec2 normal = octahedralEncode(normal3);
+            packed[targets[2]] = quantizeSnorm16(normal.x);
+            packed[targets[2] + 1] = quantizeSnorm16(normal.y);
+        }
+        if (present[3])
+            packed[targets[3]] = (unsigned short)glm::clamp(vertex[sources[3]], 0.0f, 65535.0f);
+    }
+    result.stride = components * sizeof(unsigned short);
+    result.attributes = attributes;
+    result.positionMin = low;
+    result.positionExtent = extent;
+    result.uvMin = uvLow;
+    result.uvExtent = uvExtent;
+    return true;
+}
+
+// sets up the attribute pointers of the bound vertex array and buffer
+// -------------------------------------------------------------------
+inline void setVertexAttributes(const std::vector<VertexAttribute>& attributes, unsigned int floatsPerVertex)
+{
+    unsigned int stride = floatsPerVertex * sizeof(float);
+    for (const VertexAttribute& attribute : attributes)
+    {
+        glEnableVertexAttribArray(attribute.index);
+        glVertexAttribPointer(attribute.index, attribute.size, GL_FLOAT, GL_FALSE, stride, (void*)(attribute.offset * sizeof(float)));
+    }
+}
+
+inline void setVertexAttributes(const std::vector<PackedAttribute>& attributes, unsigned int stride)
+{
+    for (const PackedAttribute& attribute : attributes)
+    {
+        glEnableVertexAttribArray(attribute.index);
+        glVertexAttribPointer(attribute.index, attribute.size, attribute.type, attribute.normalized, stride, (void*)(size_t)attribute.offset);
+    }
+}
+
+#endif
@@ -0,0 +1,126 @@
+// checks the quantized vertex format (vertex_format.h) on the CPU: unit
+// normals sent through octahedralEncode(), quantizeSnorm16() and back the way
+// GL reads them and octahedralDecode(), and a generated dome sent through
+// quantizeVertices() and back the way 6.2.cubemaps_quantized.vs and the model
+// matrix undo it. prints the largest error of each and fails if one of them
+// is larger than the format should allow.
+//
+// usage: vertex_format_check
+//
+// it is its own executable next to the chapter; the headers only need the GL
+// declarations, nothing is called:
+//   g++ -std=c++17 -O2 -I<includes> vertex_format_check.cpp -o vertex_format_check
+#include "procedural_mesh.h"
+#include "vertex_format.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+// the largest errors accepted: 16 bits over the octahedral square keep
+// normals within about a hundredth of a degree (the snorm16 bias included),
+// positions and uvs within a step of their range
+const float MAX_NORMAL_ERROR_DEGREES = 0.02f;
+const float MAX_UNORM_ERROR = 1.0f / 65535.0f;
+
+// a snorm16 component as GL before 4.2 reads it back, see quantizeSnorm16()
+// ------------------------------------------------------------------------
+float readSnorm16(unsigned short value)
+{
+    return (2.0f * (float)(short)value + 1.0f) / 65535.0f;
+}
+
+// from the sine and the cosine, since the arc cosine alone loses the small
+// angles this is about to float rounding
+float angleDegrees(const glm::vec3& a, const glm::vec3& b)
+{
+    glm::vec3 x = glm::normalize(a), y = glm::normalize(b);
+    return glm::degrees(std::atan2(glm::length(glm::cross(x, y)), glm::dot(x, y)));
+}
+
+// unit normals spread over the whole sphere, poles and axes included
+// ------------------------------------------------------------------
+float worstNormalRoundTrip()
+{
+    std::vector<glm::vec3> normals = {
+        glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(-1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f),
+        glm::vec3(0.0f, -1.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(0.0f, 0.0f, -1.0f),
+    };
+    const int STEPS = 256;
+    for (int i = 0; i <= STEPS; ++i)
+    {
+        float theta = 3.14159265358979f * (float)i / STEPS;
+        for (int j = 0; j < 2 * STEPS; ++j)
+        {
+            float phi = 3.14159265358979f * (float)j / STEPS;
+            normals.push_back(glm::vec3(std::sin(theta) * std::cos(phi), std::sin(theta) * std::sin(phi), std::cos(theta)));
+        }
+    }
+    float worst = 0.0f;
+    for (const glm::vec3& normal : normals)
+    {
+        glm::vec2 encoded = octahedralEncode(normal);
+        glm::vec2 stored(readSnorm16(quantizeSnorm16(encoded.x)), readSnorm16(quantizeSnorm16(encoded.y)));
+        worst = std::max(worst, angleDegrees(octahedralDecode(stored), normal));
+    }
+    return worst;
+}
+
+int main()
+{
+    bool passed = true;
+    float normalError = worstNormalRoundTrip();
+    std::cout << "octahedral snorm16 normals: " << normalError << " degrees at most" << std::endl;
+    passed = passed && normalError <= MAX_NORMAL_ERROR_DEGREES;
+
+    // a whole mesh, whose stored normals are scaled by the position extent
+    // that the normal matrix of its model divides out again
+    ProceduralMesh dome = generateDome(1.0f, 64, 32);
+    unsigned int floatsPerVertex = 8;
+    unsigned int vertexCount = (unsigned int)(dome.vertices.size() / floatsPerVertex);
+    QuantizedVertices quantized;
+    if (!quantizeVertices(&dome.vertices[0], vertexCount, floatsPerVertex, proceduralMeshLayout(), quantized))
+    {
+        std::cout << "the procedural mesh layout has no quantized form" << std::endl;
+        return 1;
+    }
+    unsigned int position = 0, uv = 0, normal = 0;
+    for (const PackedAttribute& attribute : quantized.attributes)
+    {
+        unsigned int at = attribute.offset / sizeof(unsigned short);
+        if (attribute.index == 0)
+            position = at;
+        else if (attribute.index == 1)
+            uv = at;
+        else if (attribute.index == 2)
+            normal = at;
+    }
+    unsigned int components = quantized.stride / sizeof(unsigned short);
+    float positionError = 0.0f, uvError = 0.0f, meshNormalError = 0.0f;
+    for (unsigned int v = 0; v < vertexCount; ++v)
+    {
+        const float* vertex = &dome.vertices[(size_t)v * floatsPerVertex];
+        const unsigned short* packed = &quantized.data[(size_t)v * components];
+        glm::vec3 storedPosition(packed[position] / 65535.0f, packed[position + 1] / 65535.0f, packed[position + 2] / 65535.0f);
+        glm::vec3 decodedPosition = glm::vec3(quantized.positionTransform() * glm::vec4(storedPosition, 1.0f));
+        glm::vec2 storedUv(packed[uv] / 65535.0f, packed[uv + 1] / 65535.0f);
+        glm::vec4 uvTransform = quantized.uvTransform();
+        glm::vec2 decodedUv = storedUv * glm::vec2(uvTransform.x, uvTransform.y) + glm::vec2(uvTransform.z, uvTransform.w);
+        glm::vec2 storedNormal(readSnorm16(packed[normal]), readSnorm16(packed[normal + 1]));
+        // the normal matrix of positionTransform, a scale by the extent
+        glm::vec3 decodedNormal = octahedralDecode(storedNormal) / quantized.positionExtent;
+        glm::vec3 original(vertex[3], vertex[4], vertex[5]);
+        for (int axis = 0; axis < 3; ++axis)
+            positionError = std::max(positionError, std::fabs(decodedPosition[axis] - vertex[axis]) / quantized.positionExtent[axis]);
+        for (int axis = 0; axis < 2; ++axis)
+            uvError = std::max(uvError, std::fabs(decodedUv[axis] - vertex[6 + axis]) / quantized.uvExtent[axis]);
+        meshNormalError = std::max(meshNormalError, angleDegrees(decodedNormal, original));
+    }
+    std::cout << "dome, " << vertexCount << " vertices, " << quantized.stride << " bytes each (was " << floatsPerVertex * sizeof(float) << "):" << std::endl;
+    std::cout << "  position " << positionError << ", uv " << uvError << " of their range, normal " << meshNormalError << " degrees at most" << std::endl;
+    passed = passed && positionError <= MAX_UNORM_ERROR && uvError <= MAX_UNORM_ERROR && meshNormalError <= MAX_NORMAL_ERROR_DEGREES;
+
+    std::cout << (passed ? "passed" : "FAILED") << std::endl;
+    return passed ? 0 : 1;
+}